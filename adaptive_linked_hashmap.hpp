@@ -0,0 +1,572 @@
+/**
+ * implement linked_hashmap over an index that adapts to the workload
+ */
+#ifndef SJTU_ADAPTIVE_LINKEDHASHMAP_HPP
+#define SJTU_ADAPTIVE_LINKEDHASHMAP_HPP
+
+// only for std::equal_to<T>, std::hash<T> and std::less<T>
+#include <functional>
+#include <cstddef>
+// placement new, for the inline nodes
+#include <new>
+#include "utility.hpp"
+#include "exceptions.hpp"
+#include "list_iterator.hpp"
+
+namespace sjtu {
+    /**
+     * adaptive_linked_hashmap has the public interface of linked_hashmap
+     * and the same insertion-ordered entry list, but it picks the index
+     * over that list from what it observes:
+     *
+     *   - small:   up to SMALL_LIMIT entries and no index at all; a lookup
+     *              scans the list comparing cached hashes. The first
+     *              INLINE_NODES nodes live inside the map object, so a
+     *              small map does not touch the heap;
+     *   - chained: separate chaining through the nodes, the cheapest to
+     *              insert into and erase from, for churn-heavy maps;
+     *   - dense:   linear probing over an array of (hash, node) slots kept
+     *              at most 3/4 full, so a miss or a hit usually costs one
+     *              cache line of index, for read-mostly maps.
+     *
+     * The map counts reads and writes between decisions. A decision is
+     * taken whenever the index needs a rehash anyway (growth, shrinkage,
+     * or leaving the small range) and when size() operations have been
+     * sampled, and the rehash then builds whichever index the sample
+     * calls for. Either way it costs O(n) after Ω(n) operations.
+     *
+     * Only the index is rebuilt; nodes never move, so iterators and
+     * references stay valid across migrations, as across rehashes in
+     * linked_hashmap. Only non-const operations are sampled or migrate,
+     * so const lookups stay safe for concurrent readers; count() and the
+     * const overloads leave the sample alone. adapt() decides on demand.
+     */
+
+template<
+	class Key,
+	class T,
+	class Hash = std::hash<Key>,
+	class Equal = std::equal_to<Key>
+> class adaptive_linked_hashmap {
+public:
+	/**
+	 * the internal type of data.
+	 * it should have a default constructor, a copy constructor.
+	 * You can use sjtu::adaptive_linked_hashmap as value_type by typedef.
+	 */
+	typedef pair<const Key, T> value_type;
+
+	enum engine {
+		small,
+		chained,
+		dense
+	};
+
+private:
+    struct Node {
+        value_type data;
+        Node* prev;
+        Node* next;
+        // next on the same chain, chained engine only
+        Node* chain;
+        size_t hash;
+
+        Node(const value_type& d, size_t h) : data(d), prev(nullptr), next(nullptr), chain(nullptr), hash(h) {}
+    };
+
+    // a dense slot; empty while node is null
+    struct Slot {
+        size_t hash;
+        Node* node;
+    };
+
+    static const size_t SMALL_LIMIT = 8;
+    static const size_t INLINE_NODES = 8;
+    static const int MIN_BITS = 4;
+    // at least this many operations per sample, however small the map
+    static const size_t MIN_SAMPLE = 256;
+    // writes per 16 operations above which a dense map turns chained, and
+    // below which a chained map turns dense; the gap avoids flip-flopping
+    static const size_t CHURN_ENTER = 6;
+    static const size_t CHURN_LEAVE = 2;
+
+    // the iterators step through these
+    template<class, class, class> friend class list_iterator;
+
+    Node* head;
+    Node* tail;
+    size_t element_count;
+    engine mode;
+    Node** chains;
+    Slot* slots;
+    int index_bits;
+    unsigned long long seed;
+    Hash hash_func;
+    Equal equal_func;
+
+    // workload since the last decision; const lookups are not counted,
+    // so that concurrent readers of a const map share no mutable state
+    size_t reads;
+    size_t writes;
+    size_t sample_limit;
+    size_t migration_count;
+
+    alignas(Node) unsigned char inline_nodes[INLINE_NODES * sizeof(Node)];
+    unsigned inline_used;
+
+    static unsigned long long mix_hash(unsigned long long h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    static unsigned long long random_seed(const void* salt) {
+        static unsigned long long counter = 0;
+        unsigned long long x = __atomic_add_fetch(&counter, 0x9e3779b97f4a7c15ULL, __ATOMIC_RELAXED);
+        x ^= (unsigned long long)salt;
+#if defined(__x86_64__) || defined(__i386__)
+        x ^= __builtin_ia32_rdtsc();
+#endif
+        return mix_hash(x);
+    }
+
+    size_t home(size_t h) const {
+        return mix_hash(h ^ seed) >> (64 - index_bits);
+    }
+
+    size_t index_mask() const {
+        return (size_t(1) << index_bits) - 1;
+    }
+
+    Node* inline_base() {
+        return reinterpret_cast<Node*>(inline_nodes);
+    }
+
+    Node* allocate_node(const value_type& value, size_t h) {
+        for (size_t i = 0; i < INLINE_NODES; ++i) {
+            if (!(inline_used >> i & 1)) {
+                Node* node = new (inline_base() + i) Node(value, h);
+                inline_used |= 1u << i;
+                return node;
+            }
+        }
+        return new Node(value, h);
+    }
+
+    void free_node(Node* node) {
+        std::less<const Node*> before;
+        Node* base = inline_base();
+        if (before(node, base) || !before(node, base + INLINE_NODES)) {
+            delete node;
+            return;
+        }
+        node->~Node();
+        inline_used &= ~(1u << (node - base));
+    }
+
+    Node* find_node(const Key& key) const {
+        return find_node(key, hash_func(key));
+    }
+
+    Node* find_node(const Key& key, size_t h) const {
+        switch (mode) {
+        case small:
+            for (Node* node = head; node; node = node->next) {
+                if (node->hash == h && equal_func(node->data.first, key)) return node;
+            }
+            return nullptr;
+        case chained:
+            for (Node* node = chains[home(h)]; node; node = node->chain) {
+                if (node->hash == h && equal_func(node->data.first, key)) return node;
+            }
+            return nullptr;
+        default:
+            for (size_t i = home(h); slots[i].node; i = (i + 1) & index_mask()) {
+                if (slots[i].hash == h && equal_func(slots[i].node->data.first, key)) return slots[i].node;
+            }
+            return nullptr;
+        }
+    }
+
+    // find_node for the non-const paths, which are sampled
+    Node* lookup(const Key& key, size_t h) {
+        reads++;
+        return find_node(key, h);
+    }
+
+    void index_add(Node* node) {
+        if (mode == chained) {
+            Node*& bucket = chains[home(node->hash)];
+            node->chain = bucket;
+            bucket = node;
+        } else if (mode == dense) {
+            size_t i = home(node->hash);
+            while (slots[i].node) i = (i + 1) & index_mask();
+            slots[i].hash = node->hash;
+            slots[i].node = node;
+        }
+    }
+
+    void index_remove(Node* node) {
+        if (mode == chained) {
+            Node** link = &chains[home(node->hash)];
+            while (*link != node) link = &(*link)->chain;
+            *link = node->chain;
+        } else if (mode == dense) {
+            size_t mask = index_mask();
+            size_t hole = home(node->hash);
+            while (slots[hole].node != node) hole = (hole + 1) & mask;
+            // backward-shift deletion: pull later entries of the probe run
+            // into the hole unless that would put them before their home
+            for (size_t i = (hole + 1) & mask; slots[i].node; i = (i + 1) & mask) {
+                size_t wanted = home(slots[i].hash);
+                if (((i - wanted) & mask) >= ((i - hole) & mask)) {
+                    slots[hole] = slots[i];
+                    hole = i;
+                }
+            }
+            slots[hole].node = nullptr;
+        }
+    }
+
+    void free_index() {
+        delete[] chains;
+        delete[] slots;
+        chains = nullptr;
+        slots = nullptr;
+    }
+
+    /**
+     * build the index of the given engine over the list, sized for the
+     * current element count; also a plain rehash when target is mode.
+     */
+    void rebuild(engine target) {
+        if (target != mode) migration_count++;
+        free_index();
+        mode = target;
+        index_bits = 0;
+        if (target != small) {
+            // load 1/2 after the rebuild; the next one comes at load 1 for
+            // chained and 3/4 for dense, where probe runs get long past it
+            size_t wanted = element_count * 2;
+            index_bits = MIN_BITS;
+            while ((size_t(1) << index_bits) < wanted) index_bits++;
+            size_t size = size_t(1) << index_bits;
+            if (target == chained) {
+                chains = new Node*[size]();
+            } else {
+                slots = new Slot[size]();
+            }
+            for (Node* node = head; node; node = node->next) index_add(node);
+        }
+        reads = writes = 0;
+        sample_limit = element_count > MIN_SAMPLE ? element_count : MIN_SAMPLE;
+    }
+
+    /**
+     * the engine the size and the sampled mix call for, with hysteresis
+     * around the current choice.
+     */
+    engine choose() const {
+        if (element_count <= SMALL_LIMIT / 2 || (mode == small && element_count <= SMALL_LIMIT)) return small;
+        size_t total = reads + writes;
+        if (!total) return mode == small ? chained : mode;
+        size_t churn = writes * 16;
+        if (mode == dense) return churn > CHURN_ENTER * total ? chained : dense;
+        if (mode == chained) return churn < CHURN_LEAVE * total ? dense : chained;
+        return churn > CHURN_ENTER * total ? chained : dense;
+    }
+
+    bool needs_rehash() const {
+        size_t size = size_t(1) << index_bits;
+        if (mode != small && element_count <= SMALL_LIMIT / 2) return true;
+        switch (mode) {
+        case small:
+            return element_count > SMALL_LIMIT;
+        case chained:
+            return element_count > size || (index_bits > MIN_BITS && element_count * 8 < size);
+        default:
+            return element_count * 4 > size * 3 || (index_bits > MIN_BITS && element_count * 8 < size);
+        }
+    }
+
+    /**
+     * take a decision if one is due: a rehash is needed, or the sample
+     * is complete and calls for another engine.
+     */
+    void adapt_if_due() {
+        if (needs_rehash()) {
+            rebuild(choose());
+        } else if (reads + writes >= sample_limit) {
+            engine target = choose();
+            if (target != mode) {
+                rebuild(target);
+            } else {
+                reads = writes = 0;
+            }
+        }
+    }
+
+    Node* insert_node(const value_type& value, size_t h) {
+        Node* node = allocate_node(value, h);
+        if (!head) {
+            head = node;
+            tail = node;
+        } else {
+            tail->next = node;
+            node->prev = tail;
+            tail = node;
+        }
+        element_count++;
+        writes++;
+        index_add(node);
+        adapt_if_due();
+        return node;
+    }
+
+    void remove_from_list(Node* node) {
+        if (node->prev) {
+            node->prev->next = node->next;
+        } else {
+            head = node->next;
+        }
+        if (node->next) {
+            node->next->prev = node->prev;
+        } else {
+            tail = node->prev;
+        }
+    }
+
+    void copy_from(const adaptive_linked_hashmap& other) {
+        for (Node* current = other.head; current; current = current->next) {
+            Node* node = allocate_node(current->data, current->hash);
+            if (!head) {
+                head = node;
+            } else {
+                tail->next = node;
+                node->prev = tail;
+            }
+            tail = node;
+            element_count++;
+        }
+        // the copy starts where other's decisions led, with a fresh sample
+        rebuild(other.mode);
+        migration_count = 0;
+    }
+
+public:
+	/**
+	 * bidirectional, over the insertion order; see list_iterator.hpp.
+	 */
+	typedef list_iterator<adaptive_linked_hashmap, Node, value_type> iterator;
+	typedef list_iterator<adaptive_linked_hashmap, const Node, const value_type> const_iterator;
+
+	adaptive_linked_hashmap() : head(nullptr), tail(nullptr), element_count(0), mode(small),
+	                            chains(nullptr), slots(nullptr), index_bits(0), seed(random_seed(this)),
+	                            reads(0), writes(0), sample_limit(MIN_SAMPLE), migration_count(0),
+	                            inline_used(0) {}
+
+	adaptive_linked_hashmap(const adaptive_linked_hashmap &other)
+	        : head(nullptr), tail(nullptr), element_count(0), mode(small),
+	          chains(nullptr), slots(nullptr), index_bits(0), seed(random_seed(this)),
+	          hash_func(other.hash_func), equal_func(other.equal_func),
+	          reads(0), writes(0), sample_limit(MIN_SAMPLE), migration_count(0), inline_used(0) {
+	    copy_from(other);
+	}
+
+	adaptive_linked_hashmap & operator=(const adaptive_linked_hashmap &other) {
+	    if (this == &other) return *this;
+
+	    clear();
+	    hash_func = other.hash_func;
+	    equal_func = other.equal_func;
+	    copy_from(other);
+
+	    return *this;
+	}
+
+	~adaptive_linked_hashmap() {
+	    clear();
+	}
+
+	/**
+	 * access specified element with bounds checking
+	 * Returns a reference to the mapped value of the element with key equivalent to key.
+	 * If no such element exists, an exception of type `index_out_of_bound'
+	 */
+	T & at(const Key &key) {
+	    Node* node = lookup(key, hash_func(key));
+	    if (!node) throw index_out_of_bound();
+	    adapt_if_due();
+	    return node->data.second;
+	}
+
+	const T & at(const Key &key) const {
+	    Node* node = find_node(key);
+	    if (!node) throw index_out_of_bound();
+	    return node->data.second;
+	}
+
+	/**
+	 * access specified element
+	 * Returns a reference to the value that is mapped to a key equivalent to key,
+	 *   performing an insertion if such key does not already exist.
+	 */
+	T & operator[](const Key &key) {
+	    size_t h = hash_func(key);
+	    Node* node = lookup(key, h);
+	    if (node) {
+	        adapt_if_due();
+	        return node->data.second;
+	    }
+
+	    return insert_node(value_type(key, T()), h)->data.second;
+	}
+
+	/**
+	 * behave like at() throw index_out_of_bound if such key does not exist.
+	 */
+	const T & operator[](const Key &key) const {
+	    return at(key);
+	}
+
+	iterator begin() {
+	    return iterator(head, this);
+	}
+
+	const_iterator cbegin() const {
+	    return const_iterator(head, this);
+	}
+
+	iterator end() {
+	    return iterator(nullptr, this);
+	}
+
+	const_iterator cend() const {
+	    return const_iterator(nullptr, this);
+	}
+
+	bool empty() const {
+	    return element_count == 0;
+	}
+
+	size_t size() const {
+	    return element_count;
+	}
+
+	/**
+	 * clears the contents; the map starts small again.
+	 */
+	void clear() {
+	    Node* current = head;
+	    while (current) {
+	        Node* next = current->next;
+	        free_node(current);
+	        current = next;
+	    }
+	    head = nullptr;
+	    tail = nullptr;
+	    element_count = 0;
+	    free_index();
+	    mode = small;
+	    index_bits = 0;
+	    reads = writes = 0;
+	    sample_limit = MIN_SAMPLE;
+	}
+
+	/**
+	 * insert an element.
+	 * return a pair, the first of the pair is
+	 *   the iterator to the new element (or the element that prevented the insertion),
+	 *   the second one is true if insert successfully, or false.
+	 */
+	pair<iterator, bool> insert(const value_type &value) {
+	    size_t h = hash_func(value.first);
+	    Node* existing = lookup(value.first, h);
+	    if (existing) {
+	        return pair<iterator, bool>(iterator(existing, this), false);
+	    }
+
+	    return pair<iterator, bool>(iterator(insert_node(value, h), this), true);
+	}
+
+	/**
+	 * erase the element at pos.
+	 *
+	 * throw if pos pointed to a bad element (pos == this->end() || pos points an element out of this)
+	 */
+	void erase(iterator pos) {
+	    if (!pos.node || pos.map != this) throw invalid_iterator();
+
+	    Node* node = pos.node;
+	    index_remove(node);
+	    remove_from_list(node);
+	    free_node(node);
+	    element_count--;
+	    writes++;
+	    adapt_if_due();
+	}
+
+	void erase(const_iterator pos) {
+	    if (!pos.node || pos.map != this) throw invalid_iterator();
+
+	    erase(iterator(const_cast<Node*>(pos.node), this));
+	}
+
+	/**
+	 * Returns the number of elements with key
+	 *   that compares equivalent to the specified argument,
+	 *   which is either 1 or 0
+	 *     since this container does not allow duplicates.
+	 */
+	size_t count(const Key &key) const {
+	    return find_node(key) ? 1 : 0;
+	}
+
+	/**
+	 * Finds an element with key equivalent to key.
+	 * key value of the element to search for.
+	 * Iterator to an element with key equivalent to key.
+	 *   If no such element is found, past-the-end (see end()) iterator is returned.
+	 */
+	iterator find(const Key &key) {
+	    Node* node = lookup(key, hash_func(key));
+	    adapt_if_due();
+	    return node ? iterator(node, this) : end();
+	}
+
+	const_iterator find(const Key &key) const {
+	    Node* node = find_node(key);
+	    return node ? const_iterator(node, this) : cend();
+	}
+
+	/**
+	 * the index in use now.
+	 */
+	engine current_engine() const {
+	    return mode;
+	}
+
+	/**
+	 * how many times the map has switched engines.
+	 */
+	size_t migrations() const {
+	    return migration_count;
+	}
+
+	/**
+	 * decide now on whatever has been sampled so far, instead of waiting
+	 * for the sample to fill.
+	 */
+	void adapt() {
+	    engine target = choose();
+	    if (target != mode) rebuild(target);
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,467 @@
+/**
+ * micro benchmarks for sjtu::linked_hashmap.
+ *
+ *   linked_hashmap_bench [--perf] [scenario] [elements]
+ *
+ * --perf also counts cycles, cache, dTLB and branch misses per find,
+ * insert, erase and rehash, and prints their averages after the scenario.
+ * Timings taken with it on include the cost of reading the counters.
+ *
+ * scenarios:
+ *   filter   count() at varying hit ratios, with and without the Bloom filter
+ *   frozen   lookups in a map against its freeze() snapshot
+ *   collide  keys that are multiples of 2^32 under the identity std::hash,
+ *            which all share bucket 0 until chains are treeified
+ *   flood    an attacker who has learned the seeded bucket of every key
+ *            sends only keys for one bucket; the map should rekey and stay O(1)
+ *   cuckoo   count() hits and misses, and inserts, against the cuckoo engine
+ *   maintain worst-case insert latency with rehashes inside insert(), against
+ *            growth left to maintain() calls between inserts
+ *   batch    count() and insert() one key at a time, against count_batch()
+ *            and insert_batch()
+ *   intern   heap bytes per entry for values drawn from a thousand distinct
+ *            strings, plain against interned_linked_hashmap
+ *   hot      find() on a skewed stream with hot-key tracking off and on,
+ *            and how many of the true top 10 the tracker reports
+ *   dedup    window_dedup over a window of `elements` events, one offer at
+ *            a time against batches that prefetch ahead
+ *   compact  iteration and copying after heavy churn, before and after
+ *            compact()
+ *   adaptive a churn phase, a read-mostly phase and many four-entry maps,
+ *            against linked_hashmap, the cuckoo engine and the adaptive one
+ */
+// before the map headers, to fill their instrumentation hook
+#include "profiling/perf_counters.hpp"
+#include "linked_hashmap.hpp"
+#include "frozen_linked_hashmap.hpp"
+#include "cuckoo_linked_hashmap.hpp"
+#include "interned_linked_hashmap.hpp"
+#include "window_dedup.hpp"
+#include "adaptive_linked_hashmap.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <malloc.h>
+
+static unsigned long long lcg_state = 88172645463325252ULL;
+
+static unsigned long long next_random() {
+	lcg_state ^= lcg_state << 13;
+	lcg_state ^= lcg_state >> 7;
+	lcg_state ^= lcg_state << 17;
+	return lcg_state;
+}
+
+static double elapsed_ns(std::chrono::steady_clock::time_point since) {
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - since).count();
+}
+
+static unsigned long long make_key(unsigned long long x, unsigned long long *) {
+	return x;
+}
+
+static std::string make_key(unsigned long long x, std::string *) {
+	return "session:" + std::to_string(x) + ":0000000000000000";
+}
+
+/**
+ * even numbers are inserted and odd numbers always miss, so every probe
+ * lands on a random bucket whatever the hit ratio.
+ */
+template<class Key>
+static void bench_filter(const char *label, size_t elements) {
+	typedef sjtu::linked_hashmap<Key, int> Map;
+	std::vector<unsigned long long> present(elements);
+	for (size_t i = 0; i < elements; ++i) present[i] = next_random() & ~1ULL;
+
+	Map plain, filtered;
+	filtered.enable_filter();
+	for (size_t i = 0; i < elements; ++i) {
+		Key key = make_key(present[i], (Key *)nullptr);
+		plain[key] = i;
+		filtered[key] = i;
+	}
+
+	const size_t queries = 2 * elements;
+	const double ratios[] = {0.0, 0.1, 0.5, 0.9, 1.0};
+	std::vector<Key> probes;
+	probes.reserve(queries);
+	std::printf("%s keys, %zu elements\n", label, elements);
+	std::printf("%-10s %14s %14s\n", "hit_ratio", "off ns/count", "on ns/count");
+	for (double ratio : ratios) {
+		probes.clear();
+		for (size_t i = 0; i < queries; ++i) {
+			bool hit = (next_random() % 1000) < ratio * 1000;
+			probes.push_back(make_key(hit ? present[next_random() % elements] : next_random() | 1, (Key *)nullptr));
+		}
+		double ns[2];
+		size_t found[2] = {0, 0};
+		for (int on = 0; on < 2; ++on) {
+			const Map &map = on ? filtered : plain;
+			auto start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < queries; ++i) found[on] += map.count(probes[i]);
+			ns[on] = elapsed_ns(start) / queries;
+		}
+		if (found[0] != found[1]) std::printf("hit count mismatch: %zu vs %zu\n", found[0], found[1]);
+		std::printf("%-10.2f %14.2f %14.2f\n", ratio, ns[0], ns[1]);
+	}
+}
+
+static void bench_frozen(size_t elements) {
+	typedef sjtu::linked_hashmap<unsigned long long, unsigned long long> Map;
+	Map map;
+	std::vector<unsigned long long> keys(elements);
+	for (size_t i = 0; i < elements; ++i) {
+		keys[i] = next_random();
+		map[keys[i]] = i;
+	}
+	std::vector<unsigned long long> probes(2 * elements);
+	for (size_t i = 0; i < probes.size(); ++i) probes[i] = keys[next_random() % elements];
+
+	auto start = std::chrono::steady_clock::now();
+	sjtu::frozen_linked_hashmap<unsigned long long, unsigned long long> frozen = map.freeze();
+	std::printf("freeze: %.1f ms for %zu elements\n", elapsed_ns(start) / 1e6, elements);
+
+	unsigned long long sum[2] = {0, 0};
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < probes.size(); ++i) sum[0] += map.at(probes[i]);
+	double map_ns = elapsed_ns(start) / probes.size();
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < probes.size(); ++i) sum[1] += frozen.at(probes[i]);
+	double frozen_ns = elapsed_ns(start) / probes.size();
+	if (sum[0] != sum[1]) std::printf("lookup mismatch\n");
+	std::printf("%-14s %10.2f ns/at\n%-14s %10.2f ns/at\n", "linked_hashmap", map_ns, "frozen", frozen_ns);
+}
+
+static void bench_collide(size_t elements) {
+	typedef sjtu::linked_hashmap<unsigned long long, unsigned long long> Map;
+	std::printf("%-10s %14s %14s\n", "elements", "ns/insert", "ns/find");
+	for (size_t n = 1000; n <= elements; n *= 4) {
+		Map map;
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < n; ++i) map[(unsigned long long)i << 32] = i;
+		double insert_ns = elapsed_ns(start) / n;
+
+		size_t found = 0;
+		start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < n; ++i) found += map.count((next_random() % (2 * n)) << 32);
+		double find_ns = elapsed_ns(start) / n;
+		std::printf("%-10zu %14.2f %14.2f   (hits %zu)\n", n, insert_ns, find_ns, found);
+	}
+}
+
+static void bench_flood(size_t elements) {
+	typedef sjtu::linked_hashmap<unsigned long long, unsigned long long> Map;
+	std::printf("%-10s %14s %14s %14s\n", "attack", "ns/insert", "ns/find", "longest_chain");
+	for (size_t n = 500; n <= elements && n <= 8000; n *= 2) {
+		// size the table for the whole attack up front, so the attacker's
+		// bucket oracle stays valid while the keys go in
+		Map map;
+		std::vector<unsigned long long> filler(2 * n);
+		for (size_t i = 0; i < filler.size(); ++i) map[filler[i] = next_random()] = i;
+		for (size_t i = 0; i < n; ++i) map.erase(map.find(filler[i]));
+
+		std::vector<unsigned long long> attack;
+		size_t target = map.bucket(next_random());
+		while (attack.size() < n) {
+			unsigned long long key = next_random();
+			if (map.bucket(key) == target) attack.push_back(key);
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < n; ++i) map[attack[i]] = i;
+		double insert_ns = elapsed_ns(start) / n;
+
+		size_t found = 0;
+		start = std::chrono::steady_clock::now();
+		for (int round = 0; round < 10; ++round) {
+			for (size_t i = 0; i < n; ++i) found += map.count(attack[i]);
+		}
+		double find_ns = elapsed_ns(start) / (10 * n);
+		if (found != 10 * n) std::printf("lost attack keys: %zu\n", 10 * n - found);
+		std::printf("%-10zu %14.2f %14.2f %14zu\n", n, insert_ns, find_ns, map.longest_chain());
+	}
+}
+
+template<class Map>
+static void bench_engine(const char *label, size_t elements) {
+	std::vector<unsigned long long> keys(elements);
+	for (size_t i = 0; i < elements; ++i) keys[i] = next_random();
+	Map map;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < elements; ++i) map[keys[i]] = i;
+	double insert_ns = elapsed_ns(start) / elements;
+
+	size_t found = 0;
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < elements; ++i) found += map.count(keys[next_random() % elements]);
+	double hit_ns = elapsed_ns(start) / elements;
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < elements; ++i) found += map.count(next_random());
+	double miss_ns = elapsed_ns(start) / elements;
+	std::printf("%-22s %12.2f %12.2f %12.2f   (found %zu)\n", label, insert_ns, hit_ns, miss_ns, found);
+}
+
+static void bench_maintain(size_t elements) {
+	typedef sjtu::linked_hashmap<unsigned long long, unsigned long long> Map;
+	std::printf("%-22s %12s %16s %16s\n", "mode", "ns/insert", "worst insert ns", "worst maintain ns");
+	// both maps live to the end: freeing a million nodes between the runs
+	// would bill the allocator's cleanup to the next large allocation
+	Map maps[2];
+	for (int mode = 0; mode < 2; ++mode) {
+		Map &map = maps[mode];
+		map.enable_auto_grow(mode == 0);
+		double worst_insert = 0, worst_maintain = 0;
+		auto begin = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < elements; ++i) {
+			auto start = std::chrono::steady_clock::now();
+			map[next_random()] = i;
+			double ns = elapsed_ns(start);
+			if (ns > worst_insert) worst_insert = ns;
+			// an idle slot every 64 inserts
+			if (mode == 1 && i % 64 == 63) {
+				start = std::chrono::steady_clock::now();
+				map.maintain(256);
+				ns = elapsed_ns(start);
+				if (ns > worst_maintain) worst_maintain = ns;
+			}
+		}
+		double insert_ns = elapsed_ns(begin) / elements;
+		std::printf("%-22s %12.2f %16.0f %16.0f\n", mode == 0 ? "rehash in insert" : "maintain(256) / 64",
+		            insert_ns, worst_insert, worst_maintain);
+	}
+}
+
+static void bench_batch(size_t elements) {
+	typedef sjtu::linked_hashmap<unsigned long long, unsigned long long> Map;
+	std::vector<Map::value_type> values;
+	values.reserve(elements);
+	for (size_t i = 0; i < elements; ++i) values.push_back(Map::value_type(next_random(), i));
+	// half hits, half misses, in random order
+	std::vector<unsigned long long> probes(elements);
+	for (size_t i = 0; i < elements; ++i) {
+		probes[i] = i % 2 ? next_random() : values[next_random() % elements].first;
+	}
+	std::printf("%-22s %12s %12s\n", "mode", "ns/insert", "ns/count");
+	for (int batched = 0; batched < 2; ++batched) {
+		Map map;
+		auto start = std::chrono::steady_clock::now();
+		if (batched) {
+			map.insert_batch(values.data(), elements);
+		} else {
+			for (size_t i = 0; i < elements; ++i) map.insert(values[i]);
+		}
+		double insert_ns = elapsed_ns(start) / elements;
+		size_t found = 0;
+		start = std::chrono::steady_clock::now();
+		if (batched) {
+			found = map.count_batch(probes.data(), elements);
+		} else {
+			for (size_t i = 0; i < elements; ++i) found += map.count(probes[i]);
+		}
+		double count_ns = elapsed_ns(start) / elements;
+		std::printf("%-22s %12.2f %12.2f   (found %zu)\n", batched ? "batched" : "one at a time", insert_ns, count_ns, found);
+	}
+}
+
+template<class Map>
+static void bench_intern(const char *label, size_t elements) {
+	std::vector<std::string> values(1000);
+	for (size_t i = 0; i < values.size(); ++i) {
+		values[i] = "status value that does not fit inline #" + std::to_string(i);
+	}
+	size_t before = mallinfo2().uordblks;
+	Map *map = new Map;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < elements; ++i) {
+		map->insert(sjtu::pair<const unsigned long long, std::string>(i, values[next_random() % values.size()]));
+	}
+	double insert_ns = elapsed_ns(start) / elements;
+	double bytes = double(mallinfo2().uordblks - before) / elements;
+	std::printf("%-26s %12.2f %16.1f\n", label, insert_ns, bytes);
+	delete map;
+}
+
+static void bench_compact(size_t elements) {
+	typedef sjtu::linked_hashmap<unsigned long long, unsigned long long> Map;
+	Map map;
+	// replace the whole population twice over, in random order, so that
+	// list neighbours end up at unrelated addresses
+	std::vector<unsigned long long> live;
+	for (size_t i = 0; i < elements; ++i) {
+		live.push_back(next_random());
+		map[live.back()] = i;
+	}
+	for (size_t i = 0; i < elements * 2; ++i) {
+		size_t victim = next_random() % live.size();
+		map.erase(map.find(live[victim]));
+		live[victim] = next_random();
+		map[live[victim]] = i;
+	}
+	std::printf("%-22s %12s %12s %12s\n", "layout", "ns/iterate", "ns/copy", "ns/compact");
+	double compact_ns = 0;
+	for (int compacted = 0; compacted < 2; ++compacted) {
+		if (compacted) {
+			auto start = std::chrono::steady_clock::now();
+			map.compact();
+			compact_ns = elapsed_ns(start) / elements;
+		}
+		unsigned long long sum = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (Map::const_iterator it = map.cbegin(); it != map.cend(); ++it) sum += it->second;
+		double iterate_ns = elapsed_ns(start) / elements;
+		start = std::chrono::steady_clock::now();
+		Map *copy = new Map(map);
+		double copy_ns = elapsed_ns(start) / elements;
+		delete copy;
+		std::printf("%-22s %12.2f %12.2f %12.2f   (sum %llu)\n", compacted ? "compacted" : "after churn",
+		            iterate_ns, copy_ns, compact_ns, sum);
+	}
+}
+
+static void bench_hot(size_t elements) {
+	typedef sjtu::linked_hashmap<unsigned long long, unsigned long long> Map;
+	Map map;
+	for (size_t i = 0; i < elements; ++i) map[i] = i;
+	// a uniform draw to the fourth power lands on small keys far more
+	// often, so key 0 is the most popular, then key 1, and so on
+	std::vector<unsigned long long> probes(elements);
+	for (size_t i = 0; i < elements; ++i) {
+		double u = double(next_random() % 1000000) / 1000000;
+		probes[i] = (unsigned long long)(u * u * u * u * elements);
+	}
+	std::printf("%-22s %12s %12s\n", "tracking", "ns/find", "top 10 kept");
+	for (int capacity = 0; capacity <= 1024; capacity = capacity ? capacity * 16 : 64) {
+		map.enable_hot_keys(capacity);
+		size_t found = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < elements; ++i) found += map.find(probes[i]) != map.end();
+		double find_ns = elapsed_ns(start) / elements;
+		// keys 0..9 are the ten most popular by construction
+		size_t kept = 0;
+		sjtu::linked_hashmap<unsigned long long, size_t> top = map.hot_keys(10);
+		for (unsigned long long key = 0; key < 10; ++key) kept += top.count(key);
+		char label[32];
+		std::snprintf(label, sizeof(label), capacity ? "%d counters" : "off", capacity);
+		std::printf("%-22s %12.2f %12zu   (found %zu)\n", label, find_ns, kept, found);
+	}
+}
+
+static void bench_dedup(size_t elements) {
+	// four times the window, keys drawn from twice the window: about half
+	// the events repeat, and the map holds `elements` keys once warm
+	std::vector<unsigned long long> keys(elements * 4);
+	for (size_t i = 0; i < keys.size(); ++i) keys[i] = next_random() % (elements * 2);
+	static bool fresh[1024];
+	std::printf("%-22s %12s %12s\n", "mode", "ns/event", "Mevents/s");
+	for (int batched = 0; batched < 2; ++batched) {
+		sjtu::window_dedup<unsigned long long> dedup(elements);
+		size_t total = 0;
+		auto start = std::chrono::steady_clock::now();
+		if (batched) {
+			for (size_t base = 0; base < keys.size(); base += 1024) {
+				size_t n = keys.size() - base < 1024 ? keys.size() - base : 1024;
+				total += dedup.offer(keys.data() + base, n, fresh);
+			}
+		} else {
+			for (size_t i = 0; i < keys.size(); ++i) total += dedup.offer(keys[i]);
+		}
+		double ns = elapsed_ns(start) / keys.size();
+		std::printf("%-22s %12.2f %12.2f   (fresh %zu)\n", batched ? "batches of 1024" : "one at a time", ns, 1000 / ns, total);
+	}
+}
+
+template<class Map>
+static void bench_adaptive(const char *label, size_t elements) {
+	std::vector<unsigned long long> keys(elements);
+	for (size_t i = 0; i < elements; ++i) keys[i] = next_random();
+	Map map;
+	for (size_t i = 0; i < elements; ++i) map[keys[i]] = i;
+
+	// churn: replace a random entry with a fresh key, size stays put
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < elements; ++i) {
+		size_t victim = next_random() % elements;
+		map.erase(map.find(keys[victim]));
+		keys[victim] = next_random();
+		map[keys[victim]] = i;
+	}
+	double churn_ns = elapsed_ns(start) / elements;
+
+	// read-mostly: non-const finds, half of them misses
+	size_t found = 0;
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < 4 * elements; ++i) {
+		found += map.find(i & 1 ? keys[next_random() % elements] : next_random()) != map.end();
+	}
+	double read_ns = elapsed_ns(start) / (4 * elements);
+
+	// small: build, probe and drop four-entry maps
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < elements / 4; ++i) {
+		Map tiny;
+		for (unsigned long long k = 0; k < 4; ++k) tiny[i + k] = k;
+		found += tiny.count(i + 2);
+	}
+	double small_ns = elapsed_ns(start) / (elements / 4);
+	std::printf("%-26s %12.2f %12.2f %12.2f   (found %zu)\n", label, churn_ns, read_ns, small_ns, found);
+}
+
+int main(int argc, char *argv[]) {
+	bool perf = argc > 1 && !std::strcmp(argv[1], "--perf");
+	if (perf) {
+		argv++;
+		argc--;
+		if (!sjtu::perf::enable()) {
+			std::fprintf(stderr, "perf_event_open is not available here\n");
+			return 1;
+		}
+	}
+	const char *scenario = argc > 1 ? argv[1] : "filter";
+	size_t elements = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+
+	if (!std::strcmp(scenario, "filter")) {
+		bench_filter<unsigned long long>("integer", elements);
+		bench_filter<std::string>("string", elements);
+	} else if (!std::strcmp(scenario, "flood")) {
+		bench_flood(elements);
+	} else if (!std::strcmp(scenario, "collide")) {
+		bench_collide(elements);
+	} else if (!std::strcmp(scenario, "cuckoo")) {
+		std::printf("%-22s %12s %12s %12s\n", "engine", "ns/insert", "ns/hit", "ns/miss");
+		bench_engine<sjtu::linked_hashmap<unsigned long long, unsigned long long>>("linked_hashmap", elements);
+		bench_engine<sjtu::cuckoo_linked_hashmap<unsigned long long, unsigned long long>>("cuckoo_linked_hashmap", elements);
+	} else if (!std::strcmp(scenario, "maintain")) {
+		bench_maintain(elements);
+	} else if (!std::strcmp(scenario, "batch")) {
+		bench_batch(elements);
+	} else if (!std::strcmp(scenario, "intern")) {
+		std::printf("%-26s %12s %16s\n", "map", "ns/insert", "heap bytes/entry");
+		bench_intern<sjtu::linked_hashmap<unsigned long long, std::string>>("linked_hashmap", elements);
+		bench_intern<sjtu::interned_linked_hashmap<unsigned long long, std::string>>("interned_linked_hashmap", elements);
+	} else if (!std::strcmp(scenario, "compact")) {
+		bench_compact(elements);
+	} else if (!std::strcmp(scenario, "dedup")) {
+		bench_dedup(elements);
+	} else if (!std::strcmp(scenario, "hot")) {
+		bench_hot(elements);
+	} else if (!std::strcmp(scenario, "adaptive")) {
+		std::printf("%-26s %12s %12s %12s\n", "map", "ns/churn", "ns/read", "ns/4-map");
+		bench_adaptive<sjtu::linked_hashmap<unsigned long long, unsigned long long>>("linked_hashmap", elements);
+		bench_adaptive<sjtu::cuckoo_linked_hashmap<unsigned long long, unsigned long long>>("cuckoo_linked_hashmap", elements);
+		bench_adaptive<sjtu::adaptive_linked_hashmap<unsigned long long, unsigned long long>>("adaptive_linked_hashmap", elements);
+	} else if (!std::strcmp(scenario, "frozen")) {
+		bench_frozen(elements);
+	} else {
+		std::fprintf(stderr, "unknown scenario: %s\n", scenario);
+		return 1;
+	}
+	if (perf) {
+		std::printf("\nper operation, user space only:\n");
+		sjtu::perf::report(stdout);
+	}
+	return 0;
+}
@@ -0,0 +1,271 @@
+/**
+ * implement a read-only linked map that is built entirely at compile time
+ */
+#ifndef SJTU_CONSTEXPR_LINKED_MAP_HPP
+#define SJTU_CONSTEXPR_LINKED_MAP_HPP
+
+// only for std::equal_to<T>
+#include <functional>
+#include <cstddef>
+#include <string_view>
+#include "exceptions.hpp"
+
+namespace sjtu {
+    /**
+     * constexpr_linked_map is meant for static lookup tables such as opcode
+     * names or config keys. It is built from a braced list when the program
+     * is compiled, so there is no runtime construction and no heap use:
+     *
+     *     constexpr auto opcodes = sjtu::make_constexpr_linked_map<std::string_view, int>({
+     *         {"add", 0x01}, {"sub", 0x02}, {"mul", 0x03},
+     *     });
+     *
+     * Lookups use a perfect hash found at compile time (hash and displace):
+     * the key's hash picks a bucket, the bucket's seed picks a slot, and the
+     * slot names exactly one entry to compare against.
+     * Iteration follows declaration order.
+     *
+     * A duplicate key, or two keys that Hash maps to the same value, makes
+     * the initializer fail to compile (and a runtime construction throw
+     * runtime_error).
+     */
+
+    /**
+     * hash for constexpr_linked_map. std::hash is not constexpr, so keys
+     * are limited to integral types and std::string_view unless the user
+     * supplies a constexpr Hash of their own.
+     */
+    template<class Key>
+    struct constexpr_hash {
+        constexpr unsigned long long operator()(const Key &key) const {
+            return static_cast<unsigned long long>(key);
+        }
+    };
+
+    template<>
+    struct constexpr_hash<std::string_view> {
+        constexpr unsigned long long operator()(std::string_view key) const {
+            // FNV-1a
+            unsigned long long h = 0xcbf29ce484222325ULL;
+            for (size_t i = 0; i < key.size(); ++i) {
+                h ^= static_cast<unsigned char>(key[i]);
+                h *= 0x100000001b3ULL;
+            }
+            return h;
+        }
+    };
+
+template<
+	class Key,
+	class T,
+	size_t N,
+	class Hash = constexpr_hash<Key>,
+	class Equal = std::equal_to<Key>
+> class constexpr_linked_map {
+	static_assert(N > 0, "constexpr_linked_map needs at least one entry");
+
+public:
+	struct value_type {
+		Key first;
+		T second;
+	};
+
+	typedef const value_type* const_iterator;
+
+private:
+    static constexpr size_t round_up_pow2(size_t n) {
+        size_t size = 1;
+        while (size < n) size *= 2;
+        return size;
+    }
+
+    // about four keys per bucket, and a quarter of the slots left free so
+    // that the seed search converges quickly
+    static constexpr size_t BUCKETS = round_up_pow2((N + 3) / 4);
+    static constexpr size_t SLOTS = round_up_pow2(N + N / 4 + 1);
+
+    static constexpr int log2(size_t n) {
+        int bits = 0;
+        while ((size_t(1) << bits) < n) ++bits;
+        return bits;
+    }
+
+    static constexpr int SLOT_SHIFT = 64 - log2(SLOTS);
+
+    // a bucket of distinct hashes needs a few seeds on average; running out
+    // means the hashes differ in too few bits to spread over the slots
+    static constexpr unsigned MAX_SEED = 1u << 16;
+
+    static constexpr unsigned long long mix(unsigned long long h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // both levels start from one mixed hash: the low bits pick the bucket,
+    // and a multiply-shift of the seeded hash picks the slot
+    static constexpr size_t bucket_of(unsigned long long mixed) {
+        return mixed & (BUCKETS - 1);
+    }
+
+    static constexpr size_t slot_of(unsigned long long mixed, unsigned seed) {
+        return ((mixed ^ (seed * 0x9e3779b97f4a7c15ULL)) * 0xbf58476d1ce4e5b9ULL) >> SLOT_SHIFT;
+    }
+
+    value_type entries[N] = {};
+    unsigned seeds[BUCKETS] = {};
+    // index into entries; free slots point at entry 0, whose key can only
+    // live in its own slot, so the key comparison rejects them
+    unsigned slots[SLOTS] = {};
+
+    constexpr void build() {
+        Hash hash_func;
+        Equal equal_func;
+        unsigned long long hashes[N] = {};
+        size_t bucket[N] = {};
+        size_t bucket_size[BUCKETS] = {};
+        for (size_t i = 0; i < N; ++i) {
+            hashes[i] = mix(hash_func(entries[i].first));
+            bucket[i] = bucket_of(hashes[i]);
+            ++bucket_size[bucket[i]];
+        }
+
+        // group the keys by bucket
+        size_t start[BUCKETS + 1] = {};
+        for (size_t b = 0; b < BUCKETS; ++b) start[b + 1] = start[b] + bucket_size[b];
+        size_t members[N] = {};
+        size_t filled[BUCKETS] = {};
+        for (size_t i = 0; i < N; ++i) {
+            members[start[bucket[i]] + filled[bucket[i]]++] = i;
+        }
+
+        // keys with equal hashes share a bucket, and would never find
+        // distinct slots
+        for (size_t b = 0; b < BUCKETS; ++b) {
+            for (size_t i = start[b]; i < start[b + 1]; ++i) {
+                for (size_t j = start[b]; j < i; ++j) {
+                    if (hashes[members[i]] != hashes[members[j]]) continue;
+                    if (equal_func(entries[members[i]].first, entries[members[j]].first)) {
+                        throw runtime_error();  // duplicate key
+                    }
+                    throw runtime_error();  // distinct keys with equal hashes: Hash cannot tell them apart
+                }
+            }
+        }
+
+        // place the largest buckets first, while most slots are free
+        size_t by_size[N + 2] = {};
+        for (size_t b = 0; b < BUCKETS; ++b) ++by_size[bucket_size[b]];
+        for (size_t size = N; size-- > 0; ) by_size[size] += by_size[size + 1];
+        size_t order[BUCKETS] = {};
+        for (size_t b = 0; b < BUCKETS; ++b) order[--by_size[bucket_size[b]]] = b;
+
+        bool taken[SLOTS] = {};
+        size_t chosen[N] = {};
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            size_t b = order[i];
+            size_t size = bucket_size[b];
+            if (size == 0) break;
+            for (unsigned seed = 1; ; ++seed) {
+                if (seed > MAX_SEED) {
+                    throw runtime_error();  // no seed separates this bucket: Hash is too weak for these keys
+                }
+                size_t placed = 0;
+                for (; placed < size; ++placed) {
+                    size_t slot = slot_of(hashes[members[start[b] + placed]], seed);
+                    bool clash = taken[slot];
+                    for (size_t k = 0; k < placed && !clash; ++k) clash = chosen[k] == slot;
+                    if (clash) break;
+                    chosen[placed] = slot;
+                }
+                if (placed < size) continue;
+                for (size_t k = 0; k < size; ++k) {
+                    taken[chosen[k]] = true;
+                    slots[chosen[k]] = members[start[b] + k];
+                }
+                seeds[b] = seed;
+                break;
+            }
+        }
+    }
+
+    constexpr const value_type* find_entry(const Key &key) const {
+        unsigned long long mixed = mix(Hash()(key));
+        const value_type* entry = &entries[slots[slot_of(mixed, seeds[bucket_of(mixed)])]];
+        return Equal()(entry->first, key) ? entry : nullptr;
+    }
+
+public:
+	constexpr constexpr_linked_map(const value_type (&init)[N]) {
+	    for (size_t i = 0; i < N; ++i) {
+	        entries[i] = init[i];
+	    }
+	    build();
+	}
+
+	/**
+	 * access specified element with bounds checking
+	 * throw index_out_of_bound if such key does not exist.
+	 */
+	constexpr const T & at(const Key &key) const {
+	    const value_type* entry = find_entry(key);
+	    if (!entry) throw index_out_of_bound();
+	    return entry->second;
+	}
+
+	constexpr const T & operator[](const Key &key) const {
+	    return at(key);
+	}
+
+	/**
+	 * iterator to the element with key equivalent to key, or end().
+	 */
+	constexpr const_iterator find(const Key &key) const {
+	    const value_type* entry = find_entry(key);
+	    return entry ? entry : end();
+	}
+
+	constexpr size_t count(const Key &key) const {
+	    return find_entry(key) ? 1 : 0;
+	}
+
+	/**
+	 * iteration is in declaration order.
+	 */
+	constexpr const_iterator begin() const {
+	    return entries;
+	}
+
+	constexpr const_iterator end() const {
+	    return entries + N;
+	}
+
+	constexpr const_iterator cbegin() const {
+	    return begin();
+	}
+
+	constexpr const_iterator cend() const {
+	    return end();
+	}
+
+	constexpr bool empty() const {
+	    return false;
+	}
+
+	constexpr size_t size() const {
+	    return N;
+	}
+};
+
+template<class Key, class T, size_t N>
+constexpr constexpr_linked_map<Key, T, N> make_constexpr_linked_map(
+        const typename constexpr_linked_map<Key, T, N>::value_type (&init)[N]) {
+    return constexpr_linked_map<Key, T, N>(init);
+}
+
+}
+
+#endif
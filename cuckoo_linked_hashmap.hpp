@@ -0,0 +1,559 @@
+/**
+ * implement linked_hashmap over a bucketized cuckoo index
+ */
+#ifndef SJTU_CUCKOO_LINKEDHASHMAP_HPP
+#define SJTU_CUCKOO_LINKEDHASHMAP_HPP
+
+// only for std::equal_to<T> and std::hash<T>
+#include <functional>
+#include <cstddef>
+#include "utility.hpp"
+#include "exceptions.hpp"
+#include "list_iterator.hpp"
+
+namespace sjtu {
+    /**
+     * cuckoo_linked_hashmap has the public interface of linked_hashmap and
+     * the same insertion-ordered entry list, but it indexes the entries
+     * with a bucketized cuckoo table instead of chains. This bounds the
+     * cost of a lookup, not just its average:
+     *
+     *   - every key has two candidate buckets, each one cache line with
+     *     four slots, so a lookup reads at most two lines of index plus
+     *     the node it finds;
+     *   - each slot keeps a 16-bit tag of the key's hash, so other keys
+     *     in those buckets are rejected without touching their nodes;
+     *   - an insert into two full buckets searches breadth-first for the
+     *     shortest chain of displacements that frees a slot, and falls
+     *     back to a small stash when none is found within MAX_BFS buckets.
+     *
+     * The stash is scanned only while it is non-empty. Only keys whose full
+     * hashes collide can keep it from draining on growth; they stay there.
+     */
+
+template<
+	class Key,
+	class T,
+	class Hash = std::hash<Key>,
+	class Equal = std::equal_to<Key>
+> class cuckoo_linked_hashmap {
+public:
+	/**
+	 * the internal type of data.
+	 * it should have a default constructor, a copy constructor.
+	 * You can use sjtu::cuckoo_linked_hashmap as value_type by typedef.
+	 */
+	typedef pair<const Key, T> value_type;
+
+private:
+    struct Node {
+        value_type data;
+        Node* prev;
+        Node* next;
+        size_t hash;
+
+        Node(const value_type& d, size_t h) : data(d), prev(nullptr), next(nullptr), hash(h) {}
+    };
+
+    static const int SLOTS_PER_BUCKET = 4;
+    static const size_t INITIAL_BUCKETS = 4;
+    // bounds the work of one displacement search
+    static const int MAX_BFS = 256;
+    // more stashed keys than this means the table is too full; grow it
+    static const size_t STASH_LIMIT = 4;
+
+    /**
+     * one cache line of the index. A zero tag marks an empty slot; tags
+     * of stored keys are never zero.
+     */
+    struct alignas(64) Bucket {
+        unsigned short tags[SLOTS_PER_BUCKET];
+        Node* slots[SLOTS_PER_BUCKET];
+    };
+
+    // one entry of the breadth-first displacement search: a bucket, and
+    // how it was reached (the slot of the parent entry whose key moves here)
+    struct Step {
+        size_t bucket;
+        int parent;
+        int slot;
+    };
+
+    // the iterators step through these
+    template<class, class, class> friend class list_iterator;
+
+    Node* head;
+    Node* tail;
+    Bucket* buckets;
+    size_t bucket_count;
+    size_t element_count;
+    Node** stash;
+    size_t stash_count;
+    size_t stash_capacity;
+    unsigned long long seed;
+    Hash hash_func;
+    Equal equal_func;
+
+    static unsigned long long mix_hash(unsigned long long h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    static unsigned long long random_seed(const void* salt) {
+        static unsigned long long counter = 0;
+        unsigned long long x = __atomic_add_fetch(&counter, 0x9e3779b97f4a7c15ULL, __ATOMIC_RELAXED);
+        x ^= (unsigned long long)salt;
+#if defined(__x86_64__) || defined(__i386__)
+        x ^= __builtin_ia32_rdtsc();
+#endif
+        return mix_hash(x);
+    }
+
+    /**
+     * partial-key cuckoo hashing: the second bucket is derived from the
+     * first and the tag alone, so a key can be displaced to its other
+     * bucket without reading its node. alternate() is its own inverse,
+     * and never maps a bucket onto itself.
+     */
+    static unsigned short tag_of(unsigned long long mixed) {
+        unsigned short tag = mixed & 0xffff;
+        return tag ? tag : 1;
+    }
+
+    size_t primary(unsigned long long mixed) const {
+        return (mixed >> 16) & (bucket_count - 1);
+    }
+
+    size_t alternate(size_t bucket, unsigned short tag) const {
+        return (bucket ^ ((tag * 0x5bd1e995ULL) | 1)) & (bucket_count - 1);
+    }
+
+    unsigned long long mixed_of(size_t h) const {
+        return mix_hash(h ^ seed);
+    }
+
+    Node* find_node(const Key& key) const {
+        return find_node(key, hash_func(key));
+    }
+
+    Node* find_node(const Key& key, size_t h) const {
+        unsigned long long mixed = mixed_of(h);
+        unsigned short tag = tag_of(mixed);
+        size_t first = primary(mixed);
+        const Bucket* candidates[2] = {&buckets[first], &buckets[alternate(first, tag)]};
+        // both lines are known up front, so fetch them in parallel
+        __builtin_prefetch(candidates[1]);
+        for (int b = 0; b < 2; ++b) {
+            const Bucket* bucket = candidates[b];
+            for (int i = 0; i < SLOTS_PER_BUCKET; ++i) {
+                if (bucket->tags[i] == tag) {
+                    Node* node = bucket->slots[i];
+                    if (node->hash == h && equal_func(node->data.first, key)) return node;
+                }
+            }
+        }
+        for (size_t i = 0; i < stash_count; ++i) {
+            if (stash[i]->hash == h && equal_func(stash[i]->data.first, key)) return stash[i];
+        }
+        return nullptr;
+    }
+
+    static void put(Bucket& bucket, int slot, unsigned short tag, Node* node) {
+        bucket.tags[slot] = tag;
+        bucket.slots[slot] = node;
+    }
+
+    static int free_slot(const Bucket& bucket) {
+        for (int i = 0; i < SLOTS_PER_BUCKET; ++i) {
+            if (!bucket.tags[i]) return i;
+        }
+        return -1;
+    }
+
+    /**
+     * place node in one of its buckets, displacing other keys along the
+     * shortest path the search finds. Returns false if there is none
+     * within MAX_BFS buckets; nothing has moved in that case.
+     */
+    bool place(Node* node) {
+        unsigned long long mixed = mixed_of(node->hash);
+        unsigned short tag = tag_of(mixed);
+        size_t first = primary(mixed);
+
+        Step queue[MAX_BFS];
+        int queued = 0;
+        queue[queued++] = {first, -1, -1};
+        queue[queued++] = {alternate(first, tag), -1, -1};
+        for (int at = 0; at < queued; ++at) {
+            Bucket& bucket = buckets[queue[at].bucket];
+            int slot = free_slot(bucket);
+            if (slot >= 0) {
+                // shift every key on the path one step towards the free slot
+                int step = at;
+                while (queue[step].parent >= 0) {
+                    int parent = queue[step].parent;
+                    Bucket& from = buckets[queue[parent].bucket];
+                    int moved = queue[step].slot;
+                    put(buckets[queue[step].bucket], slot, from.tags[moved], from.slots[moved]);
+                    slot = moved;
+                    step = parent;
+                }
+                put(buckets[queue[step].bucket], slot, tag, node);
+                return true;
+            }
+            for (int i = 0; i < SLOTS_PER_BUCKET && queued < MAX_BFS; ++i) {
+                size_t next = alternate(queue[at].bucket, bucket.tags[i]);
+                // a path through the same bucket twice would move a key
+                // that has already moved
+                bool on_path = false;
+                for (int step = at; step >= 0 && !on_path; step = queue[step].parent) {
+                    on_path = queue[step].bucket == next;
+                }
+                if (!on_path) queue[queued++] = {next, at, i};
+            }
+        }
+        return false;
+    }
+
+    void push_stash(Node* node) {
+        if (stash_count == stash_capacity) {
+            size_t capacity = stash_capacity ? stash_capacity * 2 : STASH_LIMIT;
+            Node** grown = new Node*[capacity];
+            for (size_t i = 0; i < stash_count; ++i) grown[i] = stash[i];
+            delete[] stash;
+            stash = grown;
+            stash_capacity = capacity;
+        }
+        stash[stash_count++] = node;
+    }
+
+    /**
+     * a table this empty that still cannot place a key is not too small:
+     * the keys share full hashes, and growing would not separate them.
+     */
+    bool sparse() const {
+        return element_count * 8 < bucket_count * SLOTS_PER_BUCKET;
+    }
+
+    void initialize_table(size_t count) {
+        bucket_count = count;
+        buckets = new Bucket[bucket_count];
+        for (size_t i = 0; i < bucket_count; ++i) {
+            for (int j = 0; j < SLOTS_PER_BUCKET; ++j) put(buckets[i], j, 0, nullptr);
+        }
+    }
+
+    /**
+     * rebuild the index with count buckets, doubling until every key that
+     * does not share its full hash finds a slot.
+     */
+    void rehash(size_t count) {
+        while (true) {
+            delete[] buckets;
+            initialize_table(count);
+            stash_count = 0;
+            bool placed = true;
+            for (Node* current = head; current && placed; current = current->next) {
+                if (place(current)) continue;
+                if (stash_count < STASH_LIMIT || sparse()) {
+                    push_stash(current);
+                } else {
+                    placed = false;
+                }
+            }
+            if (placed) return;
+            count *= 2;
+        }
+    }
+
+    void link_node(Node* node) {
+        if (!head) {
+            head = node;
+            tail = node;
+        } else {
+            tail->next = node;
+            node->prev = tail;
+            tail = node;
+        }
+        element_count++;
+
+        if (place(node)) return;
+        if (stash_count < STASH_LIMIT || sparse()) {
+            push_stash(node);
+        } else {
+            // node is on the list, so the rebuild places it too
+            rehash(bucket_count * 2);
+        }
+    }
+
+    Node* insert_node(const value_type& value, size_t h) {
+        // four-way buckets fill to well over 90%; stop short of that so
+        // that displacement paths stay short
+        if (element_count >= bucket_count * SLOTS_PER_BUCKET * 0.85) {
+            rehash(bucket_count * 2);
+        }
+        Node* node = new Node(value, h);
+        link_node(node);
+        return node;
+    }
+
+    void remove_from_list(Node* node) {
+        if (node->prev) {
+            node->prev->next = node->next;
+        } else {
+            head = node->next;
+        }
+        if (node->next) {
+            node->next->prev = node->prev;
+        } else {
+            tail = node->prev;
+        }
+    }
+
+    void remove_from_index(Node* node) {
+        unsigned long long mixed = mixed_of(node->hash);
+        unsigned short tag = tag_of(mixed);
+        size_t first = primary(mixed);
+        size_t candidates[2] = {first, alternate(first, tag)};
+        for (int b = 0; b < 2; ++b) {
+            Bucket& bucket = buckets[candidates[b]];
+            for (int i = 0; i < SLOTS_PER_BUCKET; ++i) {
+                if (bucket.slots[i] == node) {
+                    put(bucket, i, 0, nullptr);
+                    // the freed slot may take a stashed key
+                    for (size_t j = 0; j < stash_count; ++j) {
+                        if (place(stash[j])) {
+                            stash[j] = stash[--stash_count];
+                            break;
+                        }
+                    }
+                    return;
+                }
+            }
+        }
+        for (size_t j = 0; j < stash_count; ++j) {
+            if (stash[j] == node) {
+                stash[j] = stash[--stash_count];
+                return;
+            }
+        }
+    }
+
+    void copy_from(const cuckoo_linked_hashmap& other) {
+        for (Node* current = other.head; current; current = current->next) {
+            link_node(new Node(current->data, current->hash));
+        }
+    }
+
+public:
+	/**
+	 * bidirectional, over the insertion order; see list_iterator.hpp.
+	 *
+	 * if there is anything wrong throw invalid_iterator.
+	 *     like it = cuckoo_linked_hashmap.begin(); --it;
+	 *       or it = cuckoo_linked_hashmap.end(); ++end();
+	 */
+	typedef list_iterator<cuckoo_linked_hashmap, Node, value_type> iterator;
+	typedef list_iterator<cuckoo_linked_hashmap, const Node, const value_type> const_iterator;
+
+	cuckoo_linked_hashmap() : head(nullptr), tail(nullptr), buckets(nullptr), bucket_count(0), element_count(0),
+	                          stash(nullptr), stash_count(0), stash_capacity(0), seed(random_seed(this)) {
+	    initialize_table(INITIAL_BUCKETS);
+	}
+
+	cuckoo_linked_hashmap(const cuckoo_linked_hashmap &other)
+	        : head(nullptr), tail(nullptr), buckets(nullptr), bucket_count(0), element_count(0),
+	          stash(nullptr), stash_count(0), stash_capacity(0), seed(random_seed(this)),
+	          hash_func(other.hash_func), equal_func(other.equal_func) {
+	    initialize_table(other.bucket_count);
+	    copy_from(other);
+	}
+
+	cuckoo_linked_hashmap & operator=(const cuckoo_linked_hashmap &other) {
+	    if (this == &other) return *this;
+
+	    clear();
+	    delete[] buckets;
+	    initialize_table(other.bucket_count);
+	    hash_func = other.hash_func;
+	    equal_func = other.equal_func;
+
+	    copy_from(other);
+
+	    return *this;
+	}
+
+	~cuckoo_linked_hashmap() {
+	    clear();
+	    delete[] buckets;
+	    delete[] stash;
+	}
+
+	/**
+	 * access specified element with bounds checking
+	 * Returns a reference to the mapped value of the element with key equivalent to key.
+	 * If no such element exists, an exception of type `index_out_of_bound'
+	 */
+	T & at(const Key &key) {
+	    Node* node = find_node(key);
+	    if (!node) throw index_out_of_bound();
+	    return node->data.second;
+	}
+
+	const T & at(const Key &key) const {
+	    Node* node = find_node(key);
+	    if (!node) throw index_out_of_bound();
+	    return node->data.second;
+	}
+
+	/**
+	 * access specified element
+	 * Returns a reference to the value that is mapped to a key equivalent to key,
+	 *   performing an insertion if such key does not already exist.
+	 */
+	T & operator[](const Key &key) {
+	    size_t h = hash_func(key);
+	    Node* node = find_node(key, h);
+	    if (node) {
+	        return node->data.second;
+	    }
+
+	    return insert_node(value_type(key, T()), h)->data.second;
+	}
+
+	/**
+	 * behave like at() throw index_out_of_bound if such key does not exist.
+	 */
+	const T & operator[](const Key &key) const {
+	    return at(key);
+	}
+
+	/**
+	 * return a iterator to the beginning
+	 */
+	iterator begin() {
+	    return iterator(head, this);
+	}
+
+	const_iterator cbegin() const {
+	    return const_iterator(head, this);
+	}
+
+	/**
+	 * return a iterator to the end
+	 * in fact, it returns past-the-end.
+	 */
+	iterator end() {
+	    return iterator(nullptr, this);
+	}
+
+	const_iterator cend() const {
+	    return const_iterator(nullptr, this);
+	}
+
+	/**
+	 * checks whether the container is empty
+	 * return true if empty, otherwise false.
+	 */
+	bool empty() const {
+	    return element_count == 0;
+	}
+
+	/**
+	 * returns the number of elements.
+	 */
+	size_t size() const {
+	    return element_count;
+	}
+
+	/**
+	 * clears the contents
+	 */
+	void clear() {
+	    Node* current = head;
+	    while (current) {
+	        Node* next = current->next;
+	        delete current;
+	        current = next;
+	    }
+	    head = nullptr;
+	    tail = nullptr;
+	    element_count = 0;
+
+	    for (size_t i = 0; i < bucket_count; ++i) {
+	        for (int j = 0; j < SLOTS_PER_BUCKET; ++j) put(buckets[i], j, 0, nullptr);
+	    }
+	    stash_count = 0;
+	}
+
+	/**
+	 * insert an element.
+	 * return a pair, the first of the pair is
+	 *   the iterator to the new element (or the element that prevented the insertion),
+	 *   the second one is true if insert successfully, or false.
+	 */
+	pair<iterator, bool> insert(const value_type &value) {
+	    size_t h = hash_func(value.first);
+	    Node* existing = find_node(value.first, h);
+	    if (existing) {
+	        return pair<iterator, bool>(iterator(existing, this), false);
+	    }
+
+	    return pair<iterator, bool>(iterator(insert_node(value, h), this), true);
+	}
+
+	/**
+	 * erase the element at pos.
+	 *
+	 * throw if pos pointed to a bad element (pos == this->end() || pos points an element out of this)
+	 */
+	void erase(iterator pos) {
+	    if (!pos.node || pos.map != this) throw invalid_iterator();
+
+	    Node* node = pos.node;
+	    remove_from_index(node);
+	    remove_from_list(node);
+	    delete node;
+	    element_count--;
+	}
+
+	void erase(const_iterator pos) {
+	    if (!pos.node || pos.map != this) throw invalid_iterator();
+
+	    erase(iterator(const_cast<Node*>(pos.node), this));
+	}
+
+	/**
+	 * Returns the number of elements with key
+	 *   that compares equivalent to the specified argument,
+	 *   which is either 1 or 0
+	 *     since this container does not allow duplicates.
+	 */
+	size_t count(const Key &key) const {
+	    return find_node(key) ? 1 : 0;
+	}
+
+	/**
+	 * Finds an element with key equivalent to key.
+	 * key value of the element to search for.
+	 * Iterator to an element with key equivalent to key.
+	 *   If no such element is found, past-the-end (see end()) iterator is returned.
+	 */
+	iterator find(const Key &key) {
+	    Node* node = find_node(key);
+	    return node ? iterator(node, this) : end();
+	}
+
+	const_iterator find(const Key &key) const {
+	    Node* node = find_node(key);
+	    return node ? const_iterator(node, this) : cend();
+	}
+};
+
+}
+
+#endif
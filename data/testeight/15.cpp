@@ -0,0 +1,69 @@
+#include "constexpr_linked_map.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+constexpr auto opcodes = sjtu::make_constexpr_linked_map<std::string_view, int>({
+	{"nop", 0x00}, {"add", 0x01}, {"sub", 0x02}, {"mul", 0x03}, {"div", 0x04},
+	{"mod", 0x05}, {"and", 0x06}, {"or", 0x07}, {"xor", 0x08}, {"not", 0x09},
+	{"shl", 0x0a}, {"shr", 0x0b}, {"load", 0x10}, {"store", 0x11}, {"jmp", 0x20},
+	{"jz", 0x21}, {"jnz", 0x22}, {"call", 0x30}, {"ret", 0x31}, {"halt", 0xff},
+});
+//	multiples of a power of two all collide under a plain mask
+constexpr auto sizes = sjtu::make_constexpr_linked_map<int, const char *>({
+	{0, "zero"}, {64, "small"}, {128, "medium"}, {256, "large"}, {512, "huge"},
+});
+//	lookups are constant expressions
+static_assert(opcodes.size() == 20);
+static_assert(opcodes.at("halt") == 0xff);
+static_assert(opcodes["store"] == 0x11);
+static_assert(opcodes.count("push") == 0);
+static_assert(opcodes.find("pop") == opcodes.end());
+static_assert(sizes.count(256) == 1 && sizes.count(192) == 0);
+//	distinct keys that this hash cannot tell apart
+struct halved {
+	constexpr unsigned long long operator()(int key) const {
+		return key / 2;
+	}
+};
+void tester(void) {
+	//	test: iteration follows declaration order
+	for (auto it = opcodes.cbegin(); it != opcodes.cend(); ++it) {
+		std::cout << it->first << '=' << it->second << ' ';
+	}
+	std::cout << std::endl;
+	for (const auto &entry : sizes) {
+		std::cout << entry.first << ':' << entry.second << ' ';
+	}
+	std::cout << std::endl;
+	//	test: runtime lookups, hits and misses
+	std::string names[] = {"add", "jnz", "push", "", "halt", "ad", "addd"};
+	for (const std::string &name : names) {
+		auto it = opcodes.find(name);
+		std::cout << (it == opcodes.end() ? -1 : it->second) << ' ';
+	}
+	std::cout << std::endl;
+	for (int size = 0; size <= 1024; size += 32) {
+		std::cout << sizes.count(size);
+	}
+	std::cout << std::endl;
+	//	test: at() throws on a missing key
+	try {
+		opcodes.at("push");
+		assert(false);
+	} catch (sjtu::index_out_of_bound &) {
+		std::cout << "index_out_of_bound" << std::endl;
+	}
+	//	test: equal hashes of distinct keys are rejected, not searched forever
+	try {
+		sjtu::constexpr_linked_map<int, int, 3, halved> colliding({{1, 1}, {2, 2}, {3, 3}});
+		std::cout << colliding.size() << std::endl;
+	} catch (sjtu::runtime_error &) {
+		std::cout << "runtime_error" << std::endl;
+	}
+	sjtu::constexpr_linked_map<int, int, 3, halved> distinct({{1, 1}, {2, 2}, {4, 4}});
+	std::cout << distinct.at(4) << ' ' << distinct.count(3) << std::endl;
+}
+int main() {
+	tester();
+	return 0;
+}
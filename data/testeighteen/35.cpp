@@ -0,0 +1,90 @@
+#include "profiling/cache_policy.hpp"
+#include <iostream>
+#include <cassert>
+typedef sjtu::linked_hashmap<int, int> Map;
+void print(const Map &map) {
+	for (Map::const_iterator it = map.cbegin(); it != map.cend(); ++it) {
+		std::cout << it->first << ' ';
+	}
+	std::cout << std::endl;
+}
+template<class Cache>
+size_t misses(size_t capacity, const unsigned long long *keys, size_t n) {
+	Cache cache(capacity);
+	size_t total = 0;
+	for (size_t i = 0; i < n; ++i) {
+		total += !cache.access(keys[i]);
+	}
+	return total;
+}
+void tester(void) {
+	//	test: move_to_back reorders and restamps
+	Map map;
+	for (int i = 0; i < 5; ++i) {
+		map[i] = i;
+	}
+	unsigned long long before = map.stamp(map.find(1));
+	map.move_to_back(map.find(1));
+	map.move_to_back(map.find(0));
+	map.move_to_back(map.find(0));
+	print(map);
+	size_t restamped = 0;
+	restamped += map.stamp(map.find(1)) > before;
+	restamped += map.stamp(map.find(0)) > map.stamp(map.find(1));
+	assert(restamped == 2);
+	map.erase(map.find(4));
+	map[9] = 9;
+	print(map);
+	try {
+		map.move_to_back(map.end());
+		assert(false);
+	} catch (sjtu::invalid_iterator &) {}
+	Map other(map);
+	try {
+		map.move_to_back(other.begin());
+		assert(false);
+	} catch (sjtu::invalid_iterator &) {}
+	//	test: Belady's anomaly under FIFO, none under LRU
+	const unsigned long long belady[12] = {1, 2, 3, 4, 1, 2, 5, 1, 2, 3, 4, 5};
+	std::cout << misses<sjtu::cache::fifo_cache>(3, belady, 12) << ' '
+	          << misses<sjtu::cache::fifo_cache>(4, belady, 12) << ' '
+	          << misses<sjtu::cache::lru_cache>(3, belady, 12) << ' '
+	          << misses<sjtu::cache::lru_cache>(4, belady, 12) << std::endl;
+	//	test: CLOCK gives referenced keys a second chance
+	const unsigned long long second[8] = {1, 2, 3, 1, 4, 1, 2, 3};
+	std::cout << misses<sjtu::cache::clock_cache>(3, second, 8) << ' '
+	          << misses<sjtu::cache::fifo_cache>(3, second, 8) << std::endl;
+	//	test: SLRU keeps keys seen twice through a scan
+	unsigned long long scan[40];
+	for (int i = 0; i < 40; ++i) {
+		scan[i] = i < 10 ? i % 2 : i < 30 ? 100 + i : i % 2;
+	}
+	std::cout << misses<sjtu::cache::slru_cache>(5, scan, 40) << ' '
+	          << misses<sjtu::cache::lru_cache>(5, scan, 40) << std::endl;
+	//	test: stack distances agree with LRU simulated at each capacity
+	unsigned long long keys[5000];
+	unsigned long long x = 12345;
+	for (int i = 0; i < 5000; ++i) {
+		x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+		keys[i] = (x >> 33) % ((x >> 60) & 1 ? 50 : 800);
+	}
+	sjtu::cache::lru_stack stack(5000);
+	for (int i = 0; i < 5000; ++i) {
+		stack.access(keys[i]);
+	}
+	std::cout << stack.accesses() << ' ' << stack.distinct_keys() << std::endl;
+	for (size_t capacity = 0; capacity <= 1024; capacity = capacity ? capacity * 4 : 1) {
+		size_t simulated = 5000 - misses<sjtu::cache::lru_cache>(capacity, keys, 5000);
+		assert(simulated == stack.hits(capacity));
+		std::cout << capacity << ':' << simulated << ' ';
+	}
+	std::cout << std::endl;
+	try {
+		stack.access(0);
+		assert(false);
+	} catch (sjtu::runtime_error &) {}
+}
+int main() {
+	tester();
+	return 0;
+}
@@ -0,0 +1,119 @@
+#include "cuckoo_linked_hashmap.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+class Integer {
+public:
+	static int counter;
+	int val;
+	Integer(int val) : val(val) {
+		counter++;
+	}
+	Integer(const Integer &rhs) {
+		val = rhs.val;
+		counter++;
+	}
+	Integer & operator = (const Integer &) {
+		assert(false);
+		return *this;
+	}
+	~Integer() {
+		counter--;
+	}
+};
+int Integer::counter = 0;
+class Hash {
+public:
+	unsigned int operator () (const Integer &lhs) const {
+		int val = lhs.val;
+		return std::hash<int>()(val);
+	}
+};
+class Equal {
+public:
+	bool operator () (const Integer &lhs, const Integer &rhs) const {
+		return lhs.val == rhs.val;
+	}
+};
+// three keys per full hash, so some of them end up in the stash
+class Clumped {
+public:
+	unsigned int operator () (int val) const {
+		return val / 3;
+	}
+};
+typedef sjtu::cuckoo_linked_hashmap<Integer, std::string, Hash, Equal> Map;
+void tester(void) {
+	//	test: insertion order survives growth and erases
+	Map map;
+	for (int i = 0; i < 100000; ++i) {
+		map[Integer(i * 7)] = std::to_string(i);
+	}
+	for (int i = 0; i < 100000; i += 2) {
+		map.erase(map.find(Integer(i * 7)));
+	}
+	long long sum = 0, index = 0;
+	for (Map::const_iterator it = map.cbegin(); it != map.cend(); ++it) {
+		sum += ++index * it->first.val;
+	}
+	std::cout << map.size() << ' ' << sum << ' ' << map.at(Integer(7)) << ' ' << map.count(Integer(14)) << std::endl;
+	//	test: insert, copy and assignment
+	size_t inserted = map.insert(sjtu::pair<Integer, std::string>(Integer(7), "x")).second;
+	inserted += map.insert(sjtu::pair<Integer, std::string>(Integer(14), "y")).second;
+	assert(inserted == 1);
+	Map copy(map), assigned;
+	assigned[Integer(-1)] = "gone";
+	assigned = copy;
+	assert(assigned.size() == map.size() && assigned.at(Integer(14)) == "y");
+	assert((--assigned.end())->first.val == 14);
+	try {
+		map.at(Integer(16));
+		assert(false);
+	} catch (sjtu::index_out_of_bound &) {}
+	try {
+		--map.begin();
+		assert(false);
+	} catch (sjtu::invalid_iterator &) {}
+	//	test: postfix steps return the position they started from
+	Map::iterator jt = map.end();
+	jt--;
+	Map::iterator old = jt--;
+	Map::const_iterator first = old++;
+	std::cout << first->first.val << ' ' << jt->first.val << ' ' << (old == map.cend()) << std::endl;
+	//	test: keys with equal full hashes
+	sjtu::cuckoo_linked_hashmap<int, int, Clumped> clumped;
+	for (int i = 0; i < 3000; ++i) {
+		clumped[i] = i;
+	}
+	for (int i = 0; i < 3000; i += 3) {
+		clumped.erase(clumped.find(i + 1));
+	}
+	int found = 0;
+	for (int i = 0; i < 3000; ++i) {
+		found += clumped.count(i);
+	}
+	std::cout << clumped.size() << ' ' << found << ' ' << clumped.begin()->first << ' ' << (--clumped.end())->first << std::endl;
+	//	test: erase takes a const_iterator too
+	Map::const_iterator gone = map.find(Integer(7));
+	map.erase(gone);
+	map.erase(map.cbegin());
+	try {
+		map.erase(copy.cbegin());
+		assert(false);
+	} catch (sjtu::invalid_iterator &) {}
+	try {
+		map.erase(map.cend());
+		assert(false);
+	} catch (sjtu::invalid_iterator &) {}
+	std::cout << map.size() << ' ' << map.count(Integer(7)) << ' ' << map.cbegin()->first.val << ' ' << copy.size() << std::endl;
+	clumped.clear();
+	assert(clumped.empty() && clumped.count(2) == 0);
+	map.clear();
+	copy.clear();
+	assigned.clear();
+	std::cout << Integer::counter << std::endl;
+}
+int main() {
+	tester();
+	return 0;
+}
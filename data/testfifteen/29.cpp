@@ -0,0 +1,72 @@
+#include "interned_linked_hashmap.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+typedef sjtu::interned_linked_hashmap<int, std::string> Map;
+void print(const Map &map) {
+	for (Map::const_iterator it = map.cbegin(); it != map.cend(); ++it) {
+		std::cout << it->first << '=' << it->second << ' ';
+	}
+	std::cout << "| " << map.size() << ' ' << map.distinct_values() << std::endl;
+}
+void tester(void) {
+	//	test: many entries, few distinct values
+	const char *status[] = {"queued", "running", "done"};
+	Map map;
+	for (int i = 0; i < 100000; ++i) {
+		map.insert(sjtu::pair<const int, std::string>(i, status[i % 3]));
+	}
+	std::cout << map.size() << ' ' << map.distinct_values() << std::endl;
+	assert(map.at(4).get() == "running");
+	//	test: assignment is copy-on-write
+	map[4] = "failed";
+	assert(map.at(4).get() == "failed" && map.at(1).get() == "running" && map.at(7).get() == "running");
+	std::cout << map.distinct_values() << std::endl;
+	map[4] = "failed";
+	map[4] = "running";
+	std::cout << map.distinct_values() << std::endl;
+	//	test: values whose last user goes away leave the pool
+	map[10] = "cancelled";
+	map.erase(map.find(10));
+	assert(map.count(10) == 0);
+	std::cout << map.distinct_values() << std::endl;
+	//	test: operator[] inserts the default value
+	std::string fresh = map[-1];
+	assert(fresh.empty());
+	std::cout << map.size() << ' ' << map.distinct_values() << std::endl;
+	//	test: copies own their pool
+	map.clear();
+	for (int i = 0; i < 6; ++i) {
+		map[i] = status[i % 2];
+	}
+	Map copy(map);
+	copy[0] = copy[1];
+	copy[2] = "done";
+	print(map);
+	print(copy);
+	map = copy;
+	map.erase(map.find(2));
+	print(map);
+	//	test: exceptions
+	try {
+		map.at(100);
+		assert(false);
+	} catch (sjtu::index_out_of_bound &) {}
+	try {
+		map.erase(map.end());
+		assert(false);
+	} catch (sjtu::invalid_iterator &) {}
+	try {
+		map.erase(copy.find(3));
+		assert(false);
+	} catch (sjtu::invalid_iterator &) {}
+	std::cout << map.size() << ' ' << copy.size() << ' ' << copy.distinct_values() << std::endl;
+	const Map &constant = map;
+	std::cout << constant.at(5) << ' ' << (constant.find(100) == constant.end()) << std::endl;
+	map.clear();
+	print(map);
+}
+int main() {
+	tester();
+	return 0;
+}
@@ -0,0 +1,74 @@
+#include "linked_hashmap.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+typedef sjtu::linked_hashmap<int, std::string> Map;
+size_t bytes(const int &, const std::string &value) {
+	return sizeof(int) + value.size();
+}
+void print(const Map &map) {
+	for (Map::const_iterator it = map.cbegin(); it != map.cend(); ++it) {
+		std::cout << it->first << ' ';
+	}
+	std::cout << "| " << map.size() << ' ' << map.total_weight() << std::endl;
+}
+void tester(void) {
+	//	test: inserts over the budget evict from the head
+	Map map;
+	map.set_weigher(bytes);
+	map.set_max_weight(100);
+	for (int i = 0; i < 20; ++i) {
+		map.insert(Map::value_type(i, std::string(i, '*')));
+	}
+	print(map);
+	//	test: an entry heavier than the budget is rejected
+	sjtu::pair<Map::iterator, bool> result = map.insert(Map::value_type(100, std::string(200, '*')));
+	std::cout << result.second << ' ' << (result.first == map.end()) << std::endl;
+	try {
+		sjtu::linked_hashmap<int, std::string> tiny;
+		tiny.set_weigher(bytes);
+		tiny.set_max_weight(2);
+		tiny[1];
+		assert(false);
+	} catch (sjtu::runtime_error &) {}
+	//	test: reweigh keeps the total exact after assignments
+	size_t kept = 0;
+	map[19] = "";
+	kept += map.reweigh(map.find(19));
+	print(map);
+	map[50] = std::string(60, '*');
+	kept += map.reweigh(map.find(50));
+	print(map);
+	map[50] = std::string(100, '*');
+	kept += map.reweigh(map.find(50));
+	assert(kept == 2 && map.count(50) == 0);
+	print(map);
+	//	test: copies, erase and clear keep the total
+	map[1] = "one";
+	map.reweigh(map.find(1));
+	Map copy(map);
+	copy.erase(copy.find(1));
+	print(copy);
+	//	test: merging evicts down to the destination's budget
+	Map extra;
+	for (int i = 200; i < 210; ++i) {
+		extra[i] = "abcdef";
+	}
+	map.merge_ordered(sjtu::merge_first_wins(), extra);
+	print(map);
+	//	test: lowering the budget and unlimited weight
+	map.set_max_weight(30);
+	print(map);
+	map.set_max_weight(0);
+	for (int i = 0; i < 10; ++i) {
+		map[i] = "0123456789";
+		map.reweigh(map.find(i));
+	}
+	print(map);
+	map.clear();
+	print(map);
+}
+int main() {
+	tester();
+	return 0;
+}
@@ -0,0 +1,146 @@
+#include "frozen_linked_hashmap.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+struct Point {
+	int x, y;
+};
+class Hash {
+public:
+	unsigned int operator () (int key) const {
+		return std::hash<int>()(key);
+	}
+};
+//	every key collides with 99 others
+class Clustered {
+public:
+	unsigned int operator () (int key) const {
+		return key / 100;
+	}
+};
+typedef sjtu::linked_hashmap<int, Point, Hash> Map;
+typedef sjtu::frozen_linked_hashmap<int, Point, Hash> Frozen;
+static_assert(std::is_nothrow_move_constructible<Frozen>::value && std::is_nothrow_move_assignable<Frozen>::value,
+              "moving a frozen map never allocates");
+std::string read_file(const char *path) {
+	std::string image;
+	std::FILE *file = std::fopen(path, "rb");
+	for (int c; file && (c = std::fgetc(file)) != EOF; ) {
+		image += (char)c;
+	}
+	if (file) std::fclose(file);
+	return image;
+}
+void write_file(const char *path, const std::string &image) {
+	std::FILE *file = std::fopen(path, "wb");
+	std::fwrite(image.data(), 1, image.size(), file);
+	std::fclose(file);
+}
+// overwrite the 64-bit header field at offset (8 = count, 48 = slots_offset)
+std::string patched(std::string image, size_t offset, unsigned long long value) {
+	std::memcpy(&image[offset], &value, sizeof(value));
+	return image;
+}
+// whether open() rejects image
+bool rejected(const std::string &image) {
+	const char *path = "/tmp/frozen_linked_hashmap_corrupt.bin";
+	write_file(path, image);
+	try {
+		Frozen::open(path);
+	} catch (sjtu::runtime_error &) {
+		return true;
+	}
+	return false;
+}
+void tester(void) {
+	Map map;
+	for (int i = 0; i < 50000; ++i) {
+		map[i * 7919 % 100003] = Point{i, -i};
+	}
+	for (int i = 0; i < 50000; i += 3) {
+		map.erase(map.find(i * 7919 % 100003));
+	}
+	//	test: freeze keeps size, order and values
+	Frozen frozen = map.freeze();
+	assert(frozen.size() == map.size());
+	Map::const_iterator it = map.cbegin();
+	for (Frozen::const_iterator jt = frozen.cbegin(); jt != frozen.cend(); ++jt, ++it) {
+		assert(jt->first == it->first && jt->second.x == it->second.x);
+	}
+	int found = 0;
+	for (int key = 0; key < 100003; ++key) {
+		if (frozen.count(key)) {
+			assert(frozen.at(key).x == map.at(key).x);
+			++found;
+		} else {
+			assert(!map.count(key));
+		}
+	}
+	std::cout << frozen.size() << ' ' << found << ' ' << frozen.cbegin()->first << std::endl;
+	//	test: save and map the file back
+	frozen.save("/tmp/frozen_linked_hashmap_test.bin");
+	Frozen loaded = Frozen::open("/tmp/frozen_linked_hashmap_test.bin");
+	assert(loaded.size() == frozen.size());
+	for (Frozen::const_iterator jt = frozen.cbegin(); jt != frozen.cend(); ++jt) {
+		assert(loaded[jt->first].y == jt->second.y);
+	}
+	std::cout << loaded.at(7919).x << ' ' << loaded.count(0) << ' ' << loaded.count(100003) << std::endl;
+	//	test: opening with other types fails
+	try {
+		sjtu::frozen_linked_hashmap<int, int, Hash>::open("/tmp/frozen_linked_hashmap_test.bin");
+		assert(false);
+	} catch (sjtu::runtime_error &) {
+		std::cout << "runtime_error" << std::endl;
+	}
+	//	test: truncated and corrupt files are rejected before any lookup
+	std::string image = read_file("/tmp/frozen_linked_hashmap_test.bin");
+	unsigned long long count;
+	std::memcpy(&count, &image[8], sizeof(count));
+	std::cout << rejected(image) << ' ' << rejected(image.substr(0, image.size() - 1))
+	          << ' ' << rejected(patched(image, 8, count + 1)) << ' ' << rejected(patched(image, 48, 1ULL << 40))
+	          << ' ' << rejected(image.substr(0, 40)) << std::endl;
+	//	test: corrupt slots make lookups miss instead of reading past the file
+	std::string scrambled = image;
+	unsigned long long slots_offset, overflow_offset;
+	std::memcpy(&slots_offset, &image[48], sizeof(slots_offset));
+	std::memcpy(&overflow_offset, &image[56], sizeof(overflow_offset));
+	for (size_t i = slots_offset; i < overflow_offset; ++i) {
+		scrambled[i] = (i & 3) == 3 && (i & 4) ? (char)0x80 : (char)0x7f;
+	}
+	write_file("/tmp/frozen_linked_hashmap_corrupt.bin", scrambled);
+	Frozen broken = Frozen::open("/tmp/frozen_linked_hashmap_corrupt.bin");
+	std::cout << broken.size() << ' ' << broken.count(7919) << std::endl;
+	std::remove("/tmp/frozen_linked_hashmap_corrupt.bin");
+	//	test: colliding hashes, copies and the empty map
+	sjtu::linked_hashmap<int, int, Clustered> clustered;
+	for (int i = 0; i < 10000; ++i) clustered[i] = i * 2;
+	sjtu::frozen_linked_hashmap<int, int, Clustered> frozen_clustered(clustered.freeze());
+	long long sum = 0;
+	for (int i = -100; i < 10100; ++i) {
+		if (frozen_clustered.count(i)) sum += frozen_clustered.at(i);
+	}
+	Frozen empty, copy(loaded);
+	assert(empty.empty() && empty.find(1) == empty.cend());
+	empty.save("/tmp/frozen_linked_hashmap_empty.bin");
+	Frozen reopened = Frozen::open("/tmp/frozen_linked_hashmap_empty.bin");
+	std::remove("/tmp/frozen_linked_hashmap_empty.bin");
+	empty = copy;
+	Frozen moved(static_cast<Frozen &&>(copy));
+	std::cout << sum << ' ' << empty.size() << ' ' << reopened.size() << ' ' << moved.size() << ' ' << copy.size()
+	          << ' ' << copy.count(7919) << std::endl;
+	copy = static_cast<Frozen &&>(moved);
+	std::cout << copy.size() << ' ' << moved.size() << ' ' << moved.cbegin() - moved.cend() << std::endl;
+	try {
+		copy.at(100003);
+		assert(false);
+	} catch (sjtu::index_out_of_bound &) {
+		std::cout << "index_out_of_bound" << std::endl;
+	}
+}
+int main() {
+	tester();
+	return 0;
+}
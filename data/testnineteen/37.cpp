@@ -0,0 +1,53 @@
+#include "profiling/hash_quality.hpp"
+#include <iostream>
+#include <cassert>
+#include <functional>
+#include <string>
+#include <vector>
+class Hash {
+public:
+	unsigned int operator () (int key) const {
+		return std::hash<int>()(key);
+	}
+};
+class Constant {
+public:
+	size_t operator () (int key) const {
+		return key / 4;
+	}
+};
+void tester(void) {
+	std::vector<int> sequential, strided;
+	for (int i = 0; i < 3000; ++i) {
+		sequential.push_back(i);
+		strided.push_back(i * 4096);
+	}
+	//	test: identity hashes fill masked tables but never avalanche
+	sjtu::hash_quality_report report = sjtu::analyze_hash(sequential.data(), sequential.size(), Hash());
+	sjtu::print_report(report, stdout);
+	assert(report.mask.buckets == 4096 && report.modulo.buckets == 4099);
+	assert(report.mask.collisions == 0 && report.avalanche_bias == 1);
+	//	test: strided keys collide under masking
+	report = sjtu::analyze_hash(strided.data(), strided.size(), Hash());
+	sjtu::print_report(report, stdout);
+	assert(report.stuck_bits == 0xfff && report.mask.longest == 3000);
+	//	test: fmix_hash repairs them
+	report = sjtu::analyze_hash(strided.data(), strided.size(), sjtu::fmix_hash<Hash>());
+	assert(report.output_bits == 64 && report.avalanche_bias < 0.1);
+	assert(report.mask.probe_length < report.mask.expected_probe_length * 1.25);
+	std::cout << report.recommendation << std::endl;
+	//	test: hash values shared by distinct keys
+	report = sjtu::analyze_hash(sequential.data(), sequential.size(), Constant(), 64);
+	std::cout << report.distinct_hashes << ' ' << report.mask.buckets << ' ' << report.recommendation << std::endl;
+	//	test: non-integral keys skip the avalanche
+	std::vector<std::string> strings;
+	for (int i = 0; i < 100; ++i) {
+		strings.push_back(std::to_string(i));
+	}
+	report = sjtu::analyze_hash(strings.data(), strings.size(), std::hash<std::string>());
+	std::cout << report.keys << ' ' << report.distinct_hashes << ' ' << report.avalanche_bias << std::endl;
+}
+int main() {
+	tester();
+	return 0;
+}
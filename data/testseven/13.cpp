@@ -0,0 +1,101 @@
+#include "linked_hashmap.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+typedef sjtu::linked_hashmap<int, std::string> Map;
+class Concat {
+public:
+	void operator () (std::string &kept, std::string &incoming) const {
+		kept += incoming;
+	}
+};
+class Fragile {
+public:
+	static bool armed;
+	int val;
+	Fragile(int v = 0) : val(v) {}
+	Fragile(const Fragile &other) : val(other.val) {
+		if (armed) throw sjtu::runtime_error();
+	}
+	Fragile & operator = (const Fragile &other) = default;
+};
+bool Fragile::armed = false;
+typedef sjtu::linked_hashmap<int, Fragile> FragileMap;
+void print(const Map &map) {
+	for (Map::const_iterator it = map.cbegin(); it != map.cend(); ++it) {
+		std::cout << it->first << ':' << it->second << ' ';
+	}
+	std::cout << map.size() << std::endl;
+}
+void tester(void) {
+	//	test: stamps follow arrival order across maps
+	Map a, b, c;
+	for (int i = 0; i < 3000; ++i) {
+		Map &map = i % 3 == 0 ? a : (i % 3 == 1 ? b : c);
+		map[i % 1000] = std::string(1, 'a' + i % 26);
+	}
+	assert(a.stamp(a.cbegin()) < b.stamp(b.cbegin()));
+	Map copy(a);
+	assert(copy.stamp(copy.cbegin()) == a.stamp(a.cbegin()));
+	//	test: first-wins merge keeps global order and empties the sources
+	Map global;
+	global[-1] = "head";
+	Map last(global), combined(global);
+	global.merge_ordered(sjtu::merge_first_wins(), a, b, c);
+	assert(a.empty() && b.empty() && c.empty());
+	assert(global.size() == 1001);
+	int expect = -1;
+	size_t misplaced = 0;
+	for (Map::const_iterator it = global.cbegin(); it != global.cend(); ++it) {
+		misplaced += it->first != expect++;
+	}
+	assert(misplaced == 0);
+	std::cout << global[0] << global[1] << global[999] << std::endl;
+	//	test: last-wins and combine policies
+	Map d, e, f;
+	for (int i = 0; i < 20; ++i) {
+		(i & 1 ? d : e)[i % 7] = std::string(1, 'a' + i);
+		f[i % 5] = std::string(1, 'A' + i);
+	}
+	Map g(d), h(e);
+	Map *sources[] = {&d, &e};
+	combined.merge_ordered(sources, 2, Concat());
+	print(combined);
+	last.merge_ordered(sjtu::merge_last_wins(), g, h, f);
+	print(last);
+	//	test: merging a map into itself is a no-op
+	last.merge_ordered(sjtu::merge_first_wins(), last);
+	print(last);
+	//	test: a throwing copy out of a slab leaves the source whole
+	FragileMap plain, target;
+	for (int i = 0; i < 10; ++i) {
+		plain[i] = Fragile(i);
+	}
+	FragileMap slabbed(plain);
+	assert(slabbed.slab_nodes() == 10);
+	Fragile::armed = true;
+	try {
+		target.merge_ordered(sjtu::merge_first_wins(), slabbed);
+		assert(false);
+	} catch (sjtu::runtime_error &) {}
+	Fragile::armed = false;
+	std::cout << slabbed.size() << ' ' << target.size() << ' ' << slabbed.at(0).val << std::endl;
+	//	test: a drained source keeps working with its filter on
+	Map filtered;
+	filtered.enable_filter(true);
+	for (int i = 0; i < 100; ++i) {
+		filtered[i] = "f";
+	}
+	global.merge_ordered(sjtu::merge_first_wins(), filtered);
+	assert(filtered.empty() && filtered.filter_enabled());
+	size_t found = 0;
+	for (int i = 0; i < 100; ++i) {
+		found += filtered.count(i);
+	}
+	filtered[5] = "again";
+	std::cout << found << ' ' << filtered.count(5) << ' ' << filtered.count(6) << ' ' << global.size() << std::endl;
+}
+int main() {
+	tester();
+	return 0;
+}
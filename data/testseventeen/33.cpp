@@ -0,0 +1,60 @@
+#include "profiling/trace_recorder.hpp"
+#include "linked_hashmap.hpp"
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+const char *path = "/tmp/linked_hashmap_seventeen.trace";
+void dump() {
+	std::FILE *in = std::fopen(path, "rb");
+	assert(in);
+	if (!sjtu::trace::read_magic(in)) {
+		std::cout << "bad trace" << std::endl;
+		std::fclose(in);
+		return;
+	}
+	int op;
+	unsigned long long hash;
+	while (sjtu::trace::decode(in, op, hash)) {
+		std::cout << sjtu::trace::operation_name(op) << ' ' << hash << std::endl;
+	}
+	assert(std::feof(in));
+	std::fclose(in);
+}
+void tester(void) {
+	sjtu::linked_hashmap<int, int> map, other;
+	map[1] = 1;
+	//	test: every public operation is recorded
+	size_t started = sjtu::trace::start(path);
+	started += sjtu::trace::start(path);
+	assert(started == 1);
+	map[2] = 2;
+	map.insert(sjtu::pair<const int, int>(3, 3));
+	map.insert(sjtu::pair<const int, int>(3, 4));
+	map.count(4);
+	map.find(1);
+	map.at(2);
+	try {
+		map.at(1000000);
+	} catch (sjtu::index_out_of_bound &) {}
+	map.erase(map.find(2));
+	const int keys[3] = {1, 300, 70000};
+	map.count_batch(keys, 3);
+	other[5] = 5;
+	map.clear();
+	std::cout << sjtu::trace::stop() << std::endl;
+	dump();
+	//	test: recording one map only
+	started = sjtu::trace::start(path, &other);
+	assert(started == 1);
+	map[7] = 7;
+	other[8] = 8;
+	other.count(-1);
+	map.clear();
+	std::cout << sjtu::trace::stop() << ' ' << sjtu::trace::stop() << std::endl;
+	dump();
+	std::remove(path);
+}
+int main() {
+	tester();
+	return 0;
+}
@@ -0,0 +1,122 @@
+#include "linked_hashmap.hpp"
+#include <iostream>
+#include <cassert>
+#include <vector>
+struct Clumped {
+	size_t operator()(const long long &key) const {
+		return key % 3;
+	}
+};
+template<class Map>
+void check(Map &map, const long long *keys, size_t n, bool quiet = false) {
+	bool found[64];
+	size_t total = map.count_batch(keys, n, found);
+	const Map &constant = map;
+	long long *values[64];
+	const long long *const_values[64];
+	size_t hits = 0;
+	hits += map.find_batch(keys, n, values);
+	assert(hits == total);
+	hits += constant.find_batch(keys, n, const_values);
+	assert(hits == 2 * total);
+	for (size_t i = 0; i < n; ++i) {
+		assert(found[i] == (map.count(keys[i]) == 1));
+		assert(values[i] == const_values[i]);
+		if (found[i]) {
+			assert(values[i] == &map.find(keys[i])->second);
+		} else {
+			assert(values[i] == nullptr);
+		}
+	}
+	if (quiet) return;
+	std::cout << total << ' ';
+	for (size_t i = 0; i < n; ++i) {
+		std::cout << found[i];
+	}
+	std::cout << std::endl;
+}
+void tester(void) {
+	typedef sjtu::linked_hashmap<long long, long long> Map;
+	Map map;
+	//	test: batched insert skips present keys and repeats within the batch
+	std::vector<Map::value_type> values;
+	values.push_back(Map::value_type(0, 0));
+	values.push_back(Map::value_type(1, 1));
+	values.push_back(Map::value_type(1, 100));
+	values.push_back(Map::value_type(2, 2));
+	for (int i = 4; i < 40; ++i) {
+		values.push_back(Map::value_type(i * 7, i));
+	}
+	std::cout << map.insert_batch(values.data(), 40) << ' ' << map.size() << std::endl;
+	std::cout << map.insert_batch(values.data(), 40) << ' ' << map[1] << std::endl;
+	for (Map::iterator it = map.begin(); it != map.end(); ++it) {
+		std::cout << it->first << ' ';
+	}
+	std::cout << std::endl;
+	//	test: batched lookups agree with count() and find(), in any group size
+	long long keys[50];
+	for (int i = 0; i < 50; ++i) {
+		keys[i] = i * 5;
+	}
+	check(map, keys, 50);
+	check(map, keys, 3);
+	check(map, keys + 41, 9);
+	assert(map.count_batch(keys, 0) == 0);
+	//	test: rehashes through the batched kernel keep every key
+	for (long long i = 0; i < 100000; ++i) {
+		map[i * 1000003] = i;
+	}
+	for (long long i = 0; i < 100000; i += 997) {
+		assert(map.at(i * 1000003) == i);
+	}
+	check(map, keys, 50);
+	//	test: lookups in the middle of an incremental rehash
+	Map growing;
+	growing.enable_auto_grow(false);
+	for (long long i = 0; i < 5000; ++i) {
+		growing[i * 5] = i;
+	}
+	while (growing.maintain(64)) {
+		check(growing, keys, 50, true);
+	}
+	check(growing, keys, 50);
+	//	test: colliding keys are treeified and rekeyed to SipHash
+	sjtu::linked_hashmap<long long, long long, Clumped> clumped;
+	std::vector<Map::value_type> many;
+	for (int i = 0; i < 300; ++i) {
+		many.push_back(Map::value_type(i * 2, i));
+	}
+	std::cout << clumped.insert_batch(many.data(), 300) << std::endl;
+	check(clumped, keys, 50);
+	//	test: a rekey partway through a group sends the rest of it to the new buckets
+	Map flooded;
+	for (long long i = 0; i < 2000; ++i) {
+		flooded[i * 1000003] = i;
+	}
+	size_t target = flooded.bucket(-1), buckets = flooded.bucket_count();
+	std::vector<Map::value_type> attack;
+	for (long long key = 1; attack.size() < 300; ++key) {
+		if (flooded.bucket(-key) == target) attack.push_back(Map::value_type(-key, key));
+	}
+	size_t landed = flooded.insert_batch(attack.data(), 300);
+	size_t reachable = 0;
+	std::vector<bool> used(buckets);
+	size_t spread = 0;
+	for (size_t i = 0; i < attack.size(); ++i) {
+		reachable += flooded.count(attack[i].first);
+		size_t b = flooded.bucket(attack[i].first);
+		spread += !used[b];
+		used[b] = true;
+	}
+	std::cout << landed << ' ' << reachable << ' ' << flooded.size() << ' ' << (flooded.bucket_count() == buckets)
+	          << ' ' << (spread > 250) << std::endl;
+	//	test: weights apply to batched inserts
+	Map weighted;
+	weighted.set_weigher([](const long long &, const long long &value) -> size_t { return value; });
+	weighted.set_max_weight(30);
+	std::cout << weighted.insert_batch(values.data(), 40) << ' ' << weighted.size() << ' ' << weighted.total_weight() << std::endl;
+}
+int main() {
+	tester();
+	return 0;
+}
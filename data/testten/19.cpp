@@ -0,0 +1,64 @@
+#include "linked_hashmap.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+typedef sjtu::linked_hashmap<int, std::string> Map;
+long long checksum(const Map &map) {
+	long long sum = 0, index = 0;
+	for (Map::const_iterator it = map.cbegin(); it != map.cend(); ++it) {
+		sum += ++index * it->first + (long long)it->second.size();
+	}
+	return sum;
+}
+void tester(void) {
+	//	test: with automatic growth off, only maintain() grows the table
+	Map map;
+	map.enable_auto_grow(false);
+	assert(!map.auto_grow_enabled());
+	for (int i = 0; i < 1000; ++i) {
+		map[i] = std::to_string(i);
+	}
+	std::cout << map.bucket_count() << ' ' << map.size() << ' ' << map.at(999) << std::endl;
+	//	test: an incremental rehash in small steps, with the map in use between steps
+	int steps = 0;
+	while (map.maintain(16)) {
+		++steps;
+		for (int i = steps; i < 900; i += 97) {
+			assert(map.at(i) == std::to_string(i));
+		}
+		map.erase(map.find(900 + steps));
+		assert(map.count(900 + steps) == 0);
+	}
+	std::cout << map.bucket_count() << ' ' << map.size() << ' ' << steps << ' ' << checksum(map) << std::endl;
+	//	test: nothing to do once the table fits
+	size_t busy = 0;
+	busy += map.maintain(1000000);
+	assert(busy == 0);
+	//	test: shrink after erases
+	while (map.size() > 20) {
+		map.erase(map.begin());
+	}
+	while (map.maintain(64));
+	std::cout << map.bucket_count() << ' ' << map.size() << ' ' << checksum(map) << std::endl;
+	//	test: copies and clear in the middle of a rehash
+	for (int i = 0; i < 500; ++i) {
+		map[-i] = "x";
+	}
+	busy += map.maintain(8);
+	assert(busy == 1);
+	for (int i = 0; i < 100; ++i) {
+		map[i * 7] = "y";
+		map.erase(map.find(-i * 3));
+	}
+	Map copy(map);
+	assert(checksum(copy) == checksum(map));
+	map.clear();
+	assert(map.empty() && map.count(0) == 0);
+	map[1] = "one";
+	while (copy.maintain(8));
+	std::cout << copy.bucket_count() << ' ' << copy.size() << ' ' << checksum(copy) << ' ' << map[1] << std::endl;
+}
+int main() {
+	tester();
+	return 0;
+}
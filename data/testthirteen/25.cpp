@@ -0,0 +1,58 @@
+#include "tiered_linked_hashmap.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+typedef sjtu::tiered_linked_hashmap<int, std::string> Map;
+std::string value_of(int i) {
+	return std::string(i % 50 + 1, 'a' + i % 26);
+}
+void tester(void) {
+	std::string path = "/tmp/tiered_linked_hashmap_test_" + std::to_string(getpid()) + ".seg";
+	Map map(path.c_str(), 64 * 1024);
+	//	test: the oldest values spill once the budget is exceeded
+	size_t inserted = 0;
+	for (int i = 0; i < 20000; ++i) {
+		inserted += map.insert(sjtu::pair<const int, std::string>(i, value_of(i)));
+	}
+	inserted += map.insert(sjtu::pair<const int, std::string>(5, "x"));
+	assert(inserted == 20000);
+	assert(map.resident_bytes() <= 64 * 1024);
+	std::cout << map.size() << ' ' << (map.spilled_count() > 15000) << ' ' << (map.segment_bytes() > 0) << std::endl;
+	//	test: spilled values fault back transparently
+	bool same = true;
+	for (int i = 0; i < 20000; i += 7) {
+		same = same && map.at(i) == value_of(i);
+	}
+	map[3] += "!";
+	std::cout << same << ' ' << map.at(3) << ' ' << map[20000].size() << ' ' << map.size() << std::endl;
+	try {
+		map.at(-1);
+		assert(false);
+	} catch (sjtu::index_out_of_bound &) {}
+	//	test: erases leave dead records behind, and compaction drops them
+	size_t erased = 0;
+	for (int i = 0; i < 20000; i += 2) {
+		erased += map.erase(i);
+	}
+	erased += map.erase(0);
+	assert(erased == 10000 && map.count(0) == 0 && map.count(1) == 1);
+	size_t before = map.segment_bytes();
+	map.compact();
+	bool shrunk = map.segment_bytes() < before;
+	same = true;
+	for (int i = 1; i < 20000; i += 2) {
+		same = same && map.at(i) == (i == 3 ? value_of(3) + "!" : value_of(i));
+	}
+	std::cout << shrunk << ' ' << same << ' ' << map.size() << std::endl;
+	//	test: a smaller budget spills at once
+	map.set_memory_budget(1024);
+	assert(map.resident_bytes() <= 1024);
+	map.clear();
+	assert(map.empty() && map.segment_bytes() == 0 && map.spilled_count() == 0);
+	map[1] = "one";
+	std::cout << map.at(1) << ' ' << map.size() << std::endl;
+}
+int main() {
+	tester();
+	return 0;
+}
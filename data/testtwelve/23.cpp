@@ -0,0 +1,116 @@
+#include "shm_linked_hashmap.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+typedef sjtu::shm_linked_hashmap<int, long long> Map;
+void print(const Map &map) {
+	long long sum = 0;
+	int index = 0;
+	map.for_each([&](int key, long long value) {
+		sum += ++index * (key + value);
+	});
+	std::cout << map.size() << ' ' << sum << std::endl;
+}
+// overwrite the 64-bit header field at offset (8 = capacity, 16 = bucket_count) of segment name
+unsigned long long patch(const std::string &name, size_t offset, unsigned long long value) {
+	int fd = shm_open(name.c_str(), O_RDWR, 0);
+	assert(fd >= 0);
+	void *data = mmap(nullptr, 64, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	assert(data != MAP_FAILED);
+	unsigned long long *field = reinterpret_cast<unsigned long long *>(static_cast<char *>(data) + offset);
+	unsigned long long old = *field;
+	*field = value;
+	munmap(data, 64);
+	return old;
+}
+// whether open() rejects segment name
+bool rejected(const std::string &name) {
+	try {
+		Map::open(name.c_str());
+	} catch (sjtu::runtime_error &) {
+		return true;
+	}
+	return false;
+}
+void tester(void) {
+	std::string name = "/sjtu_shm_test_" + std::to_string(getpid());
+	Map::remove(name.c_str());
+	Map map = Map::create(name.c_str(), 5000);
+	//	test: a second create of the same name fails
+	try {
+		Map::create(name.c_str(), 10);
+		assert(false);
+	} catch (sjtu::runtime_error &) {}
+	size_t inserted = 0;
+	for (int i = 0; i < 4000; ++i) {
+		inserted += map.insert(Map::value_type{i, (long long)i * i});
+	}
+	inserted += map.insert(Map::value_type{7, 0});
+	assert(inserted == 4000);
+	print(map);
+	//	test: a child process reads and updates the same copy
+	pid_t child = fork();
+	if (child == 0) {
+		Map shared = Map::open(name.c_str());
+		bool ok = shared.size() == 4000 && shared.at(63) == 63 * 63 && shared.count(4000) == 0;
+		for (int i = 0; i < 4000; i += 2) {
+			ok = shared.erase(i) && ok;
+		}
+		for (int i = 4000; i < 6000; ++i) {
+			shared.set(i, -i);
+		}
+		shared.set(1, 100);
+		_exit(ok ? 0 : 1);
+	}
+	int status = 0;
+	waitpid(child, &status, 0);
+	assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	long long value = 0;
+	size_t found = 0;
+	found += map.get(0, value);
+	found += map.get(1, value);
+	assert(found == 1 && value == 100);
+	std::cout << map.at(5999) << ' ' << map.capacity() << std::endl;
+	print(map);
+	//	test: full map, then clear
+	for (int i = 6000; map.size() < map.capacity(); ++i) {
+		map.set(i, 0);
+	}
+	try {
+		map.set(-1, 0);
+		assert(false);
+	} catch (sjtu::runtime_error &) {}
+	try {
+		map.at(-1);
+		assert(false);
+	} catch (sjtu::index_out_of_bound &) {}
+	map.clear();
+	assert(map.empty());
+	map.set(42, 42);
+	print(map);
+	//	test: a header whose counts disagree with the segment size is rejected
+	size_t refused = 0;
+	unsigned long long buckets = patch(name, 16, 1ULL << 30);
+	refused += rejected(name);
+	patch(name, 16, buckets);
+	unsigned long long capacity = patch(name, 8, 10);
+	refused += rejected(name);
+	patch(name, 8, capacity * 2);
+	refused += rejected(name);
+	patch(name, 8, capacity);
+	refused += rejected(name);
+	std::cout << refused << ' ' << Map::open(name.c_str()).size() << std::endl;
+	Map::remove(name.c_str());
+	try {
+		Map::open(name.c_str());
+		assert(false);
+	} catch (sjtu::runtime_error &) {}
+}
+int main() {
+	tester();
+	return 0;
+}
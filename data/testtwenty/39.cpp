@@ -0,0 +1,77 @@
+#include "linked_hashmap.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+typedef sjtu::linked_hashmap<int, int> Map;
+typedef sjtu::linked_hashmap<int, size_t> Hot;
+void print(const Hot &top) {
+	for (Hot::const_iterator it = top.cbegin(); it != top.cend(); ++it) {
+		std::cout << it->first << ':' << it->second << ' ';
+	}
+	std::cout << std::endl;
+}
+void tester(void) {
+	//	test: tracking is off by default
+	Map map;
+	map[1] = 1;
+	assert(map.hot_keys(10).empty());
+	//	test: exact counts while every key has a counter
+	map.enable_hot_keys(8);
+	for (int i = 0; i < 6; ++i) {
+		map[i] = i;
+	}
+	for (int round = 0; round < 5; ++round) {
+		map.find(3);
+		map.count(3);
+		if (round < 3) map.at(1);
+		if (round < 2) map.find(42);
+	}
+	map.insert(Map::value_type(5, 0));
+	print(map.hot_keys(4));
+	assert(map.hot_keys(0).empty() && map.hot_keys(100).size() == 7);
+	//	test: const lookups leave the counts alone
+	const Map &constant = map;
+	constant.find(1);
+	constant.count(1);
+	constant.at(1);
+	print(map.hot_keys(2));
+	//	test: a skewed stream keeps its heavy hitters in a small summary
+	map.enable_hot_keys(8);
+	for (int i = 0; i < 2000; ++i) {
+		map.find(i % 2 == 0 ? 7 : i % 4 == 1 ? 8 : 1000 + i);
+	}
+	Hot top = map.hot_keys(2);
+	print(top);
+	assert(top.count(7) && top.count(8));
+	assert(top.at(7) >= 1000 && top.at(7) <= 1000 + 2000 / 8);
+	assert(map.hot_keys(10).size() == 8);
+	//	test: clear keeps the counts, copies keep only the setting
+	map.clear();
+	assert(map.hot_keys(1).count(7));
+	Map copy(map);
+	assert(copy.hot_keys(1).empty());
+	copy.find(9);
+	print(copy.hot_keys(1));
+	copy = Map();
+	copy.find(9);
+	assert(copy.hot_keys(1).empty());
+	map.enable_hot_keys(0);
+	map.find(7);
+	assert(map.hot_keys(1).empty());
+	//	test: other key types
+	sjtu::linked_hashmap<std::string, int> words;
+	words.enable_hot_keys(3);
+	const char *text[9] = {"a", "b", "a", "c", "a", "d", "b", "e", "b"};
+	for (int i = 0; i < 9; ++i) {
+		words[text[i]]++;
+	}
+	sjtu::linked_hashmap<std::string, size_t> hot = words.hot_keys(2);
+	for (sjtu::linked_hashmap<std::string, size_t>::iterator it = hot.begin(); it != hot.end(); ++it) {
+		std::cout << it->first << ':' << it->second << ' ';
+	}
+	std::cout << std::endl;
+}
+int main() {
+	tester();
+	return 0;
+}
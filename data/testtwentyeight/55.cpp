@@ -0,0 +1,91 @@
+#include "linked_hashmap.hpp"
+#include <iostream>
+#include <cassert>
+#include <vector>
+typedef sjtu::linked_hashmap<unsigned long long, unsigned long long> Map;
+//	a deterministic stream of keys for the identity std::hash
+unsigned long long next_key() {
+	static unsigned long long state = 0x2545f4914f6cdd1dULL;
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+// how many distinct buckets keys occupy
+size_t spread(const Map &map, const std::vector<unsigned long long> &keys) {
+	std::vector<bool> used(map.bucket_count());
+	size_t total = 0;
+	for (size_t i = 0; i < keys.size(); ++i) {
+		size_t b = map.bucket(keys[i]);
+		assert(b < map.bucket_count());
+		total += !used[b];
+		used[b] = true;
+	}
+	return total;
+}
+void tester(void) {
+	//	test: every instance places the same keys differently
+	Map first, second;
+	std::vector<unsigned long long> keys;
+	for (int i = 0; i < 1000; ++i) {
+		keys.push_back(next_key());
+		first[keys.back()] = i;
+		second[keys.back()] = i;
+	}
+	size_t moved = 0;
+	for (size_t i = 0; i < keys.size(); ++i) {
+		moved += first.bucket(keys[i]) != second.bucket(keys[i]);
+	}
+	std::cout << (first.bucket_count() == second.bucket_count()) << ' ' << (moved > 500) << std::endl;
+	//	test: a flood of keys for one bucket; the table is sized first so
+	//	that the attacker's bucket() oracle stays valid while they go in
+	Map map;
+	std::vector<unsigned long long> filler;
+	for (int i = 0; i < 4000; ++i) {
+		filler.push_back(next_key());
+		map[filler.back()] = i;
+	}
+	for (int i = 0; i < 2000; ++i) {
+		map.erase(map.find(filler[i]));
+	}
+	filler.erase(filler.begin(), filler.begin() + 2000);
+	size_t buckets = map.bucket_count(), target = map.bucket(next_key());
+	std::vector<unsigned long long> attack;
+	while (attack.size() < 300) {
+		unsigned long long key = next_key();
+		if (map.bucket(key) == target) attack.push_back(key);
+	}
+	size_t before = map.longest_chain();
+	for (size_t i = 0; i < attack.size(); ++i) {
+		map[attack[i]] = i;
+	}
+	//	the map noticed, switched to SipHash in place, and the flood spread out
+	std::cout << (before < 16) << ' ' << (map.longest_chain() > 16) << ' ' << (map.bucket_count() == buckets)
+	          << ' ' << (spread(map, attack) > 250) << std::endl;
+	size_t found = 0;
+	for (size_t i = 0; i < attack.size(); ++i) {
+		found += map.count(attack[i]) && map.at(attack[i]) == i;
+	}
+	for (size_t i = 0; i < filler.size(); ++i) {
+		found += map.find(filler[i]) != map.end();
+	}
+	std::cout << found << ' ' << map.size() << ' ' << map.count(next_key()) << std::endl;
+	//	test: the strong hash survives copies, erases and growth
+	Map copy(map);
+	std::cout << (spread(copy, attack) > 250) << ' ' << copy.size() << std::endl;
+	for (size_t i = 0; i < attack.size(); i += 2) {
+		copy.erase(copy.find(attack[i]));
+	}
+	for (int i = 0; i < 20000; ++i) {
+		copy[next_key()] = 0;
+	}
+	found = 0;
+	for (size_t i = 0; i < attack.size(); ++i) {
+		found += copy.count(attack[i]);
+	}
+	std::cout << found << ' ' << (copy.bucket_count() > buckets) << ' ' << (spread(copy, attack) > 250) << std::endl;
+}
+int main() {
+	tester();
+	return 0;
+}
@@ -0,0 +1,169 @@
+#include "adaptive_linked_hashmap.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <map>
+#include <vector>
+#include <cstdlib>
+typedef sjtu::adaptive_linked_hashmap<int, std::string> Map;
+const char *name(Map::engine e) {
+	return e == Map::small ? "small" : e == Map::chained ? "chained" : "dense";
+}
+void print(const Map &map) {
+	for (Map::const_iterator it = map.cbegin(); it != map.cend(); ++it) {
+		std::cout << it->first << '=' << it->second << ' ';
+	}
+	std::cout << "| " << map.size() << ' ' << name(map.current_engine()) << std::endl;
+}
+void tester(void) {
+	//	test: small maps need no index
+	Map map;
+	for (int i = 0; i < 8; ++i) {
+		map[i * 7] = std::to_string(i);
+	}
+	print(map);
+	//	test: growth leaves the small range while inserting, so chained
+	Map::iterator first = map.find(0);
+	std::string *kept = &map.at(49);
+	for (int i = 8; i < 2000; ++i) {
+		map[i * 7] = std::to_string(i);
+	}
+	std::cout << name(map.current_engine()) << ' ' << map.size() << std::endl;
+	//	test: a read-mostly phase moves to dense, iterators survive
+	size_t hits = 0;
+	for (int round = 0; round < 10; ++round) {
+		for (int i = 0; i < 3000; ++i) {
+			hits += map.find(i) != map.end();
+		}
+	}
+	assert(map.current_engine() == Map::dense && map.migrations() == 2);
+	assert(first == map.begin() && first->second == "0" && *kept == "7");
+	std::cout << hits << ' ' << name(map.current_engine()) << ' ' << first->second << ' ' << *kept << std::endl;
+	//	test: churn moves back to chained
+	for (int i = 0; i < 20000; ++i) {
+		map[100000 + i] = "x";
+		map.erase(map.find(100000 + i));
+	}
+	assert(map.current_engine() == Map::chained && map.migrations() == 3);
+	assert(map.size() == 2000 && map.begin() == first && *kept == "7");
+	//	test: insertion order holds through every engine
+	int expect = 0;
+	for (Map::iterator it = map.begin(); it != map.end(); ++it, ++expect) {
+		assert(it->first == expect * 7 && it->second == std::to_string(expect));
+	}
+	//	test: erasing back down ends small again
+	while (map.size() > 3) {
+		map.erase(map.begin());
+	}
+	print(map);
+	//	test: copies keep order and engine, and are independent
+	Map big;
+	for (int i = 0; i < 100; ++i) {
+		big[i] = std::to_string(i * i);
+	}
+	for (int i = 0; i < 2000; ++i) {
+		big.count(i % 100);
+		big.find(i % 150);
+	}
+	Map copy(big);
+	assert(copy.current_engine() == big.current_engine() && copy.size() == 100);
+	copy.erase(copy.find(50));
+	assert(big.count(50) == 1 && copy.count(50) == 0);
+	copy = map;
+	print(copy);
+	copy = copy;
+	print(copy);
+	//	test: const lookups leave the sample alone, adapt() decides early
+	Map churn;
+	for (int i = 0; i < 100; ++i) {
+		churn[i] = "";
+	}
+	const Map &view = churn;
+	size_t found = 0;
+	for (int i = 0; i < 5000; ++i) {
+		found += view.count(i % 200);
+	}
+	Map::engine before = churn.current_engine();
+	for (int i = 0; i < 300; ++i) {
+		found += churn.find(i % 100) != churn.end();
+	}
+	churn.adapt();
+	std::cout << found << ' ' << name(before) << ' ' << name(churn.current_engine()) << std::endl;
+	//	test: postfix steps return the position they started from
+	Map::iterator jt = big.end();
+	jt--;
+	Map::iterator old = jt--;
+	Map::const_iterator last = old++;
+	std::cout << last->first << ' ' << jt->first << ' ' << (old == big.cend()) << std::endl;
+	//	test: exceptions
+	try {
+		view.at(-1);
+		assert(false);
+	} catch (sjtu::index_out_of_bound &) {
+		std::cout << "index_out_of_bound" << std::endl;
+	}
+	try {
+		big.erase(big.end());
+		assert(false);
+	} catch (sjtu::invalid_iterator &) {
+		std::cout << "invalid_iterator" << std::endl;
+	}
+	try {
+		big.erase(copy.begin());
+		assert(false);
+	} catch (sjtu::invalid_iterator &) {
+		std::cout << "invalid_iterator" << std::endl;
+	}
+	try {
+		big.erase(copy.cbegin());
+		assert(false);
+	} catch (sjtu::invalid_iterator &) {
+		std::cout << "invalid_iterator" << std::endl;
+	}
+	big.erase(big.cbegin());
+	std::cout << big.size() << ' ' << big.begin()->first << std::endl;
+	//	test: random operations against std::map and an order list
+	srand(49);
+	Map fuzz;
+	std::map<int, int> model;
+	std::vector<int> order;
+	for (int step = 0; step < 200000; ++step) {
+		int phase = step / 20000 % 3;
+		int range = phase == 0 ? 12 : phase == 1 ? 3000 : 400;
+		int key = rand() % range;
+		int op = rand() % 10;
+		bool write = phase == 1 ? op < 1 : op < 6;
+		if (!write) {
+			Map::iterator it = fuzz.find(key);
+			assert((it != fuzz.end()) == (model.count(key) == 1));
+			if (it != fuzz.end()) assert(it->second == std::to_string(model[key]));
+		} else if (model.count(key)) {
+			fuzz.erase(fuzz.find(key));
+			model.erase(key);
+			for (size_t i = 0; i < order.size(); ++i) {
+				if (order[i] == key) {
+					order.erase(order.begin() + i);
+					break;
+				}
+			}
+		} else {
+			fuzz[key] = std::to_string(step);
+			model[key] = step;
+			order.push_back(key);
+		}
+		if (step % 20000 == 19999) {
+			assert(fuzz.size() == model.size());
+			size_t i = 0;
+			for (Map::const_iterator it = fuzz.cbegin(); it != fuzz.cend(); ++it, ++i) {
+				assert(it->first == order[i]);
+			}
+			std::cout << fuzz.size() << ' ' << name(fuzz.current_engine()) << std::endl;
+		}
+	}
+	fuzz.clear();
+	print(fuzz);
+}
+int main() {
+	tester();
+	return 0;
+}
@@ -0,0 +1,85 @@
+#include "linked_hashmap.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+typedef sjtu::linked_hashmap<int, std::string> Map;
+void print(const Map &map) {
+	for (Map::const_iterator it = map.cbegin(); it != map.cend(); ++it) {
+		std::cout << it->first << '=' << it->second << ' ';
+	}
+	std::cout << "| " << map.size() << ' ' << map.slab_nodes() << std::endl;
+}
+// the distance between neighbours in iteration order if it is always
+// the same, which means they sit in one slab in order; 0 otherwise
+long stride(const Map &map) {
+	Map::const_iterator first = map.cbegin(), second = map.cbegin();
+	++second;
+	long step = (const char *)&*second - (const char *)&*first;
+	const Map::value_type *last = nullptr;
+	for (Map::const_iterator it = map.cbegin(); it != map.cend(); ++it) {
+		if (last && (const char *)&*it - (const char *)last != step) return 0;
+		last = &*it;
+	}
+	return step;
+}
+void tester(void) {
+	//	test: churn, then compact
+	Map map;
+	for (int i = 0; i < 10000; ++i) {
+		map[i] = std::to_string(i);
+		if (i % 3 == 0) map.erase(map.find(i / 2));
+	}
+	size_t before = map.size();
+	unsigned long long stamp = map.stamp(map.find(9999));
+	assert(map.slab_nodes() == 0 && stride(map) == 0);
+	map.compact();
+	assert(map.size() == before && map.slab_nodes() == before && stride(map) > 0);
+	std::cout << before << ' ' << map.slab_nodes() << std::endl;
+	size_t kept = 0;
+	kept += map.stamp(map.find(9999)) == stamp;
+	assert(kept == 1 && map.at(4001) == "4001");
+	for (int i = 0; i < 10000; ++i) {
+		assert(map.count(i) == (map.find(i) != map.end()));
+	}
+	//	test: the map keeps working around the slab
+	map.erase(map.find(9999));
+	map[20000] = "new";
+	map.erase(map.begin());
+	std::cout << map.size() << ' ' << map.slab_nodes() << ' ' << map.cbegin()->first << std::endl;
+	map.compact();
+	map.compact();
+	assert(map.slab_nodes() == map.size() && stride(map) > 0 && map.at(20000) == "new");
+	//	test: copies are compact, erasing everything releases the slab
+	Map copy(map);
+	assert(copy.slab_nodes() == copy.size() && stride(copy) > 0);
+	while (!copy.empty()) {
+		copy.erase(copy.begin());
+	}
+	copy[1] = "one";
+	print(copy);
+	//	test: ordered index, trees, merges and clear across compaction
+	Map small;
+	small.enable_ordered_index();
+	for (int i = 9; i >= 0; --i) {
+		small[i * 7 % 10] = std::to_string(i);
+	}
+	small.compact();
+	for (Map::ordered_iterator it = small.lower_bound(3); it != small.upper_bound(6); ++it) {
+		std::cout << it->first << ' ';
+	}
+	std::cout << std::endl;
+	Map sink;
+	sink[3] = "kept";
+	sink.merge_ordered([](std::string &, std::string &) {}, small);
+	assert(small.empty() && small.slab_nodes() == 0);
+	print(sink);
+	sink.compact();
+	sink.clear();
+	print(sink);
+	sink.compact();
+	assert(sink.empty());
+}
+int main() {
+	tester();
+	return 0;
+}
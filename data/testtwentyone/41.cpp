@@ -0,0 +1,114 @@
+#include "multi_index_linked_hashmap.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+struct Person {
+	std::string name;
+	std::string city;
+	int age;
+};
+struct name_of {
+	std::string operator () (const Person &person) const {
+		return person.name;
+	}
+};
+struct city_of {
+	std::string operator () (const Person &person) const {
+		return person.city;
+	}
+};
+struct decade_of {
+	int operator () (const Person &person) const {
+		return person.age / 10;
+	}
+};
+typedef sjtu::multi_index_linked_hashmap<int, Person, std::hash<int>, std::equal_to<int>,
+	sjtu::hashed_index<std::string, name_of>,
+	sjtu::hashed_index<std::string, city_of>,
+	sjtu::hashed_index<int, decade_of> > Map;
+void print(const Map &map) {
+	for (Map::const_iterator it = map.cbegin(); it != map.cend(); ++it) {
+		std::cout << it->first << '=' << it->second.name << '/' << it->second.city << ' ';
+	}
+	std::cout << "| " << map.size() << std::endl;
+}
+void tester(void) {
+	//	test: lookups by every index
+	Map map;
+	const char *cities[] = {"Shanghai", "Beijing", "Hangzhou"};
+	for (int i = 0; i < 1000; ++i) {
+		map.insert(sjtu::pair<const int, Person>(i, Person{"p" + std::to_string(i), cities[i % 3], i % 80}));
+	}
+	assert(map.find_by<0>("p417")->first == 417);
+	assert(map.find_by<0>("nobody") == map.end());
+	std::cout << map.count_by<1>("Beijing") << ' ' << map.count_by<1>("Shenzhen") << ' '
+	          << map.count_by<2>(3) << std::endl;
+	size_t rejected = 0;
+	rejected += !map.insert(sjtu::pair<const int, Person>(5, Person{"dup", "Shenzhen", 1})).second;
+	assert(rejected == 1);
+	assert(map.count_by<0>("dup") == 0 && map.count_by<1>("Shenzhen") == 0);
+	//	test: updates through at() and operator[] move the entry between keys
+	map.at(1) = Person{"p1", "Shenzhen", 1};
+	assert(map.find_by<1>("Shenzhen")->first == 1 && map.count_by<1>("Beijing") == 332);
+	map[1000] = Person{"late", "Shenzhen", 99};
+	std::cout << map.count_by<1>("Shenzhen") << ' ' << map.find_by<0>("late")->first << std::endl;
+	map[1000] = map[417];
+	assert(map.count_by<0>("late") == 0 && map.count_by<0>("p417") == 2);
+	try {
+		map.at(-1) = Person{"x", "y", 0};
+		assert(false);
+	} catch (sjtu::index_out_of_bound &) {}
+	//	test: erase leaves every index
+	for (int i = 0; i < 1000; i += 2) {
+		map.erase(map.find(i));
+	}
+	std::cout << map.size() << ' ' << map.count_by<1>("Beijing") << ' ' << map.count_by<0>("p417") << std::endl;
+	assert(map.find_by<0>("p2") == map.end() && map.find_by<0>("p3")->first == 3);
+	try {
+		map.erase(map.end());
+		assert(false);
+	} catch (sjtu::invalid_iterator &) {}
+	//	test: copies have indexes of their own
+	Map copy(map);
+	copy.at(3) = Person{"renamed", "Shanghai", 3};
+	assert(copy.count_by<0>("p3") == 0 && map.count_by<0>("p3") == 1);
+	copy = map;
+	assert(copy.find_by<0>("p3")->first == 3 && copy.count_by<0>("renamed") == 0);
+	try {
+		copy.erase(map.find(3));
+		assert(false);
+	} catch (sjtu::invalid_iterator &) {}
+	copy.erase(copy.find_by<0>("p5"));
+	assert(copy.count(5) == 0 && copy.count_by<0>("p5") == 0 && map.count_by<0>("p5") == 1);
+	assert(copy.size() + 1 == map.size() && copy.find_by<0>("p3")->first == 3);
+	map.clear();
+	assert(map.find_by<0>("p3") == map.end() && map.count_by<2>(0) == 0);
+	map[7] = Person{"again", "Beijing", 7};
+	print(map);
+	std::cout << copy.size() << ' ' << copy.count_by<2>(0) << ' ' << copy.find_by<1>("Shenzhen")->first << std::endl;
+	//	test: walking every element that shares an index key
+	size_t walked = 0, misfiled = 0;
+	long long keys = 0;
+	sjtu::pair<Map::index_iterator<2>, Map::index_iterator<2> > range = copy.equal_range_by<2>(3);
+	for (Map::index_iterator<2> it = range.first; it != range.second; ++it) {
+		walked++;
+		keys += it->first;
+		misfiled += (*it).second.age / 10 != 3;
+	}
+	std::cout << walked << ' ' << copy.count_by<2>(3) << ' ' << keys << ' ' << misfiled << std::endl;
+	while (copy.equal_range_by<2>(3).first != copy.equal_range_by<2>(3).second) {
+		copy.erase(copy.equal_range_by<2>(3).first);
+	}
+	sjtu::pair<Map::index_iterator<1>, Map::index_iterator<1> > none = copy.equal_range_by<1>("Nowhere");
+	assert(none.first == none.second && copy.count_by<2>(3) == 0);
+	Map::index_iterator<1> past = none.second;
+	try {
+		++past;
+		assert(false);
+	} catch (sjtu::invalid_iterator &) {}
+	std::cout << copy.size() << ' ' << copy.count_by<2>(2) << std::endl;
+}
+int main() {
+	tester();
+	return 0;
+}
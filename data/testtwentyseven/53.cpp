@@ -0,0 +1,135 @@
+#include "linked_hashmap.hpp"
+#include <iostream>
+#include <cassert>
+#include <vector>
+//	keys 4b, 4b+1, 4b+2 and 4b+3 share the full hash b
+class Grouped {
+public:
+	size_t operator () (long long key) const {
+		return key >> 2;
+	}
+};
+//	every key shares its full hash with a fifth of the others
+class Clumped {
+public:
+	size_t operator () (long long key) const {
+		return key % 5;
+	}
+};
+template<class Map>
+void check(Map &map, const std::vector<long long> &order, long long probe) {
+	assert(map.size() == order.size());
+	size_t i = 0;
+	for (typename Map::const_iterator it = map.cbegin(); it != map.cend(); ++it, ++i) {
+		assert(it->first == order[i] && it->second == order[i] * 3);
+	}
+	for (size_t j = 0; j < order.size(); ++j) {
+		assert(map.at(order[j]) == order[j] * 3);
+	}
+	for (long long k = -probe; k < probe; ++k) {
+		size_t wanted = 0;
+		for (size_t j = 0; j < order.size(); ++j) wanted += order[j] == k;
+		assert(map.count(k) == wanted && (map.find(k) != map.end()) == (wanted == 1));
+	}
+}
+template<class Map>
+void erase(Map &map, std::vector<long long> &order, size_t index) {
+	map.erase(map.find(order[index]));
+	order.erase(order.begin() + index);
+}
+void tester(void) {
+	typedef sjtu::linked_hashmap<long long, long long, Grouped> Map;
+	//	test: a bucket grows into a tree and shrinks back into a chain;
+	//	the table is sized first so that bucket() stays valid
+	Map map;
+	for (long long i = 0; i < 400; ++i) {
+		map[-4 * (i + 1)] = -12 * (i + 1);
+	}
+	for (long long i = 0; i < 200; ++i) {
+		map.erase(map.find(-4 * (i + 1)));
+	}
+	size_t buckets = map.bucket_count(), target = map.bucket(1000000);
+	std::vector<long long> order;
+	for (long long i = 200; i < 400; ++i) {
+		order.push_back(-4 * (i + 1));
+	}
+	//	four groups of three keys with equal full hashes, in one bucket
+	std::vector<long long> attack;
+	for (long long base = 250000; attack.size() < 12; ++base) {
+		if (map.bucket(base * 4) != target) continue;
+		for (int dup = 0; dup < 3; ++dup) attack.push_back(base * 4 + dup);
+	}
+	for (size_t i = 0; i < attack.size(); ++i) {
+		map[attack[i]] = attack[i] * 3;
+		order.push_back(attack[i]);
+	}
+	assert(map.bucket_count() == buckets);
+	std::cout << map.size() << ' ' << (map.longest_chain() > 8) << std::endl;
+	check(map, order, 1000);
+	//	the fourth key of each group shares the hash but is absent
+	for (size_t i = 0; i < attack.size(); ++i) {
+		assert(map.count(attack[i] | 3) == 0);
+	}
+	//	test: erasing from the middle of dup lists and of the tree
+	erase(map, order, 201);
+	erase(map, order, 205);
+	erase(map, order, 200);
+	check(map, order, 1000);
+	//	test: below the untreeify threshold, then back above it
+	while (order.size() > 204) {
+		erase(map, order, order.size() - 2);
+	}
+	check(map, order, 1000);
+	for (size_t i = 0; i < attack.size(); ++i) {
+		if (!map.count(attack[i])) {
+			map[attack[i]] = attack[i] * 3;
+			order.push_back(attack[i]);
+		}
+	}
+	check(map, order, 1000);
+	std::cout << map.size() << ' ' << (map.bucket_count() == buckets) << std::endl;
+	//	test: removing whole groups, one of which is the root of the tree
+	for (size_t group = 0; group < attack.size(); group += 3) {
+		for (size_t dup = 0; dup < 3; ++dup) {
+			size_t index = 0;
+			while (order[index] != attack[group + dup]) ++index;
+			erase(map, order, index);
+		}
+		check(map, order, 1000);
+		for (size_t dup = 0; dup < 3; ++dup) {
+			map[attack[group + dup]] = attack[group + dup] * 3;
+			order.push_back(attack[group + dup]);
+		}
+	}
+	check(map, order, 1000);
+	//	test: copies are seeded afresh and place the keys elsewhere
+	Map copy(map);
+	check(copy, order, 1000);
+	while (order.size() > 200) {
+		erase(copy, order, 200);
+	}
+	check(copy, order, 1000);
+	//	test: hundreds of keys per full hash, past the rehash to SipHash
+	sjtu::linked_hashmap<long long, long long, Clumped> clumped;
+	std::vector<long long> keys;
+	for (long long i = 0; i < 1000; ++i) {
+		clumped[i] = i * 3;
+		keys.push_back(i);
+	}
+	check(clumped, keys, 1100);
+	for (size_t i = keys.size(); i-- > 0; ) {
+		if (i % 3 == 0 || i % 7 == 0) erase(clumped, keys, i);
+	}
+	check(clumped, keys, 1100);
+	while (keys.size() > 3) {
+		erase(clumped, keys, keys.size() / 2);
+	}
+	check(clumped, keys, 1100);
+	std::cout << clumped.size() << ' ' << clumped.cbegin()->first << ' ' << (--clumped.end())->first << std::endl;
+	clumped.clear();
+	std::cout << clumped.count(1) << std::endl;
+}
+int main() {
+	tester();
+	return 0;
+}
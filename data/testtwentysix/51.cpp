@@ -0,0 +1,83 @@
+#include "linked_hashmap.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+typedef sjtu::linked_hashmap<int, std::string> Map;
+// keys below limit that map holds, checked through count() and find()
+size_t present(Map &map, int limit) {
+	size_t total = 0;
+	for (int i = -limit; i < limit; ++i) {
+		size_t counted = map.count(i);
+		assert(counted == (map.find(i) != map.end()));
+		total += counted;
+	}
+	return total;
+}
+// the same through a const map, whose find() is a separate overload
+size_t present(const Map &map, int limit) {
+	size_t total = 0;
+	for (int i = -limit; i < limit; ++i) {
+		total += map.find(i) != map.cend();
+	}
+	return total;
+}
+void tester(void) {
+	//	test: the filter sees every insert, through growth
+	Map map;
+	map.enable_filter();
+	assert(map.filter_enabled());
+	for (int i = 0; i < 20000; i += 2) {
+		map[i] = std::to_string(i);
+	}
+	std::cout << map.size() << ' ' << present(map, 40000) << ' ' << map.at(19998) << std::endl;
+	//	test: erases leave stale bits until the filter is rebuilt
+	for (int i = 0; i < 20000; i += 4) {
+		map.erase(map.find(i));
+	}
+	std::cout << map.size() << ' ' << present(map, 40000) << ' ' << map.count(4) << ' ' << map.count(6) << std::endl;
+	for (int i = 2; i < 20000; i += 4) {
+		map.erase(map.find(i));
+	}
+	for (int i = 1; i < 100; i += 2) {
+		map.insert(Map::value_type(i, "odd"));
+	}
+	std::cout << map.size() << ' ' << present(map, 40000) << ' ' << map.cbegin()->first << std::endl;
+	//	test: incremental rehash keeps both filters in step
+	Map grown;
+	grown.enable_filter();
+	grown.enable_auto_grow(false);
+	for (int i = 0; i < 5000; ++i) {
+		grown[i * 3] = "";
+	}
+	size_t steps = 0;
+	while (grown.maintain(64)) {
+		if (++steps % 16 == 0) {
+			assert(present(grown, 16000) == 5000);
+			grown[-1 - (int)steps] = "";
+		}
+	}
+	std::cout << grown.size() << ' ' << present(grown, 16000) << ' ' << (grown.bucket_count() >= grown.size()) << std::endl;
+	//	test: copies and assignment carry the filter
+	Map copy(map);
+	const Map &view = copy;
+	assert(copy.filter_enabled());
+	copy[7] = "seven";
+	std::cout << present(map, 200) << ' ' << present(view, 200) << std::endl;
+	Map assigned;
+	assigned = grown;
+	assert(assigned.filter_enabled());
+	std::cout << present(assigned, 16000) << std::endl;
+	//	test: clear and turning the filter off and on
+	map.clear();
+	std::cout << present(map, 200) << ' ' << map.filter_enabled() << std::endl;
+	map[5] = "five";
+	map.enable_filter(false);
+	assert(!map.filter_enabled() && map.count(5) == 1);
+	map[6] = "six";
+	map.enable_filter();
+	std::cout << present(map, 200) << ' ' << map.at(6) << std::endl;
+}
+int main() {
+	tester();
+	return 0;
+}
@@ -0,0 +1,68 @@
+#include "window_dedup.hpp"
+#include <iostream>
+#include <cassert>
+#include <deque>
+#include <map>
+#include <string>
+typedef sjtu::window_dedup<int> Dedup;
+void tester(void) {
+	//	test: a window of the last 3 events
+	Dedup last3(3);
+	const int stream[12] = {1, 2, 1, 3, 4, 5, 1, 1, 6, 7, 8, 1};
+	for (int i = 0; i < 12; ++i) {
+		std::cout << (last3.offer(stream[i]) ? '+' : '-');
+	}
+	std::cout << ' ' << last3.size() << std::endl;
+	assert(last3.contains(1) && last3.contains(8) && !last3.contains(6));
+	//	test: a window of 10 time units
+	Dedup recent(0, 10);
+	std::cout << recent.offer(1, 100) << recent.offer(2, 105) << recent.offer(1, 109)
+	          << recent.offer(2, 115) << recent.offer(1, 119) << recent.offer(1, 129)
+	          << recent.offer(1, 120) << ' ';
+	recent.expire(200);
+	std::cout << recent.size() << std::endl;
+	//	test: both bounds, and a batch
+	Dedup both(2, 10);
+	int keys[8] = {1, 1, 2, 3, 1, 4, 4, 4};
+	bool fresh[8];
+	std::cout << both.offer(keys, 8, fresh, 50) << ' ';
+	for (int i = 0; i < 8; ++i) {
+		std::cout << fresh[i];
+	}
+	std::cout << ' ' << both.offer(4, 59) << both.offer(4, 70) << ' ' << both.size() << std::endl;
+	try {
+		Dedup forever(0, 0);
+		assert(false);
+	} catch (sjtu::runtime_error &) {}
+	//	test: against a replay of the window
+	sjtu::window_dedup<std::string> words(100, 500);
+	std::deque<std::pair<std::string, unsigned long long> > window;
+	unsigned long long now = 0, state = 7;
+	size_t total = 0, mismatches = 0;
+	for (int i = 0; i < 50000; ++i) {
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		std::string key = std::to_string(state >> 33 & 255);
+		now += state >> 60;
+		while (!window.empty() && (window.size() >= 100 || now - window.front().second >= 500)) {
+			window.pop_front();
+		}
+		bool expected = true;
+		for (size_t j = 0; j < window.size(); ++j) {
+			if (window[j].first == key) expected = false;
+		}
+		window.push_back(std::make_pair(key, now));
+		bool got = words.offer(key, now);
+		assert(words.size() <= 100);
+		mismatches += got != expected;
+		total += got;
+	}
+	words.clear();
+	assert(words.empty());
+	mismatches += !words.offer("0");
+	assert(mismatches == 0);
+	std::cout << total << std::endl;
+}
+int main() {
+	tester();
+	return 0;
+}
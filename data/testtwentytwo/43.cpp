@@ -0,0 +1,106 @@
+#include "linked_hashmap.hpp"
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <map>
+#include <string>
+typedef sjtu::linked_hashmap<int, int> Map;
+size_t unit(const int &, const int &) {
+	return 1;
+}
+bool descending(const int &a, const int &b) {
+	return a > b;
+}
+template<class Iterator>
+void print(Iterator first, Iterator last) {
+	for (; first != last; ++first) {
+		std::cout << first->first << ' ';
+	}
+	std::cout << std::endl;
+}
+void tester(void) {
+	//	test: range scans next to insertion order
+	Map map;
+	for (int i = 0; i < 20; ++i) {
+		map[(i * 7) % 20 * 5] = i;
+	}
+	try {
+		map.lower_bound(0);
+		assert(false);
+	} catch (sjtu::runtime_error &) {}
+	map.enable_ordered_index();
+	print(map.lower_bound(12), map.upper_bound(40));
+	print(map.lower_bound(15), map.upper_bound(15));
+	print(map.cbegin(), map.cend());
+	assert(map.lower_bound(96) == map.ordered_end() && map.upper_bound(-1) == map.ordered_begin());
+	//	test: the index follows inserts, erases, values and evictions
+	map.erase(map.find(20));
+	map.insert(Map::value_type(21, 0));
+	map.lower_bound(21)->second = 42;
+	assert(map.at(21) == 42);
+	const Map &constant = map;
+	print(constant.lower_bound(10), constant.upper_bound(30));
+	Map cache;
+	cache.enable_ordered_index();
+	cache.set_weigher(unit);
+	cache.set_max_weight(3);
+	for (int i = 10; i > 0; --i) {
+		cache[i] = i;
+	}
+	print(cache.ordered_begin(), cache.ordered_end());
+	Map other;
+	other.enable_ordered_index();
+	other[0] = 0;
+	other[2] = 2;
+	cache.merge_ordered([](int &, int &) {}, other);
+	assert(other.ordered_begin() == other.ordered_end());
+	print(cache.ordered_begin(), cache.ordered_end());
+	try {
+		*map.ordered_end();
+		assert(false);
+	} catch (sjtu::invalid_iterator &) {}
+	//	test: copies, clear and other orders
+	Map copy(map);
+	copy.erase(copy.find(0));
+	assert(copy.has_ordered_index() && copy.ordered_begin()->first == 5 && map.ordered_begin()->first == 0);
+	copy.enable_ordered_index(descending);
+	print(copy.lower_bound(30), copy.upper_bound(10));
+	copy.enable_ordered_index(nullptr);
+	assert(!copy.has_ordered_index());
+	map.clear();
+	assert(map.ordered_begin() == map.ordered_end());
+	map[3] = 3;
+	print(map.ordered_begin(), map.ordered_end());
+	//	test: against std::map under random traffic
+	sjtu::linked_hashmap<std::string, int> words;
+	words.enable_ordered_index();
+	std::map<std::string, int> reference;
+	srand(7);
+	for (int i = 0; i < 20000; ++i) {
+		std::string key = std::to_string(rand() % 2000);
+		if (rand() % 3) {
+			words[key] = i;
+			reference[key] = i;
+		} else if (words.count(key)) {
+			words.erase(words.find(key));
+			reference.erase(key);
+		}
+		if (i % 1000 == 0) {
+			std::string low = std::to_string(rand() % 2000), high = std::to_string(rand() % 2000);
+			sjtu::linked_hashmap<std::string, int>::ordered_iterator it = words.lower_bound(low);
+			std::map<std::string, int>::iterator expected = reference.lower_bound(low);
+			for (; expected != reference.upper_bound(high) && expected != reference.end(); ++it, ++expected) {
+				assert(it->first == expected->first && it->second == expected->second);
+			}
+		}
+	}
+	size_t walked = 0;
+	for (sjtu::linked_hashmap<std::string, int>::const_ordered_iterator it = words.ordered_begin(); it != words.ordered_end(); it++) {
+		walked++;
+	}
+	std::cout << walked << ' ' << reference.size() << std::endl;
+}
+int main() {
+	tester();
+	return 0;
+}
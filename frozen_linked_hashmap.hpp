@@ -0,0 +1,512 @@
+/**
+ * implement an immutable snapshot of linked_hashmap for read-only phases
+ */
+#ifndef SJTU_FROZEN_LINKEDHASHMAP_HPP
+#define SJTU_FROZEN_LINKEDHASHMAP_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "linked_hashmap.hpp"
+
+namespace sjtu {
+    /**
+     * frozen_linked_hashmap is what linked_hashmap::freeze() returns once a
+     * map stops changing. The entries sit in one dense array in insertion
+     * order, indexed by a minimal perfect hash (PTHash style: the key's hash
+     * picks a bucket, the bucket's pilot moves it to a slot in [0, size)).
+     * A lookup reads one pilot and one slot, then compares exactly one key.
+     * Keys whose full hashes collide cannot be told apart by any pilot; they
+     * share a slot that points into a small overflow list instead.
+     *
+     * The whole map is a single position-independent blob, so save() writes
+     * it to a file and open() maps that file back with mmap and no parsing.
+     * Key and T must therefore be trivially copyable, and Hash must give the
+     * same value for the same key in every process that opens the file.
+     */
+
+template<
+	class Key,
+	class T,
+	class Hash = std::hash<Key>,
+	class Equal = std::equal_to<Key>
+> class frozen_linked_hashmap {
+public:
+	struct value_type {
+		Key first;
+		T second;
+	};
+
+	typedef const value_type* const_iterator;
+
+	static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<T>::value,
+	              "frozen_linked_hashmap stores Key and T as raw bytes");
+	static_assert(alignof(value_type) <= 16, "entries must fit the blob's 16-byte alignment");
+
+private:
+    struct Header {
+        char magic[8];
+        unsigned long long count;
+        unsigned long long slot_count;
+        unsigned long long buckets;
+        unsigned long long entry_size;
+        unsigned long long pilots_offset;
+        unsigned long long slots_offset;
+        unsigned long long overflow_offset;
+        unsigned long long entries_offset;
+        unsigned long long total_size;
+    };
+
+    // a slot with this bit set holds an offset into the overflow list,
+    // which stores the group length followed by its entry indices
+    static const unsigned OVERFLOW_BIT = 0x80000000u;
+
+    static constexpr char MAGIC[8] = {'S', 'J', 'T', 'U', 'F', 'R', 'Z', '1'};
+    // average keys per bucket: fewer buckets mean less pilot memory but a
+    // longer pilot search for the last buckets
+    static const size_t KEYS_PER_BUCKET = 4;
+
+    unsigned char* blob;
+    size_t blob_size;
+    bool mapped;
+
+    const Header* header;
+    const unsigned* pilots;
+    const unsigned* slots;
+    const unsigned* overflow;
+    // words in the overflow region, which lookups stay inside
+    size_t overflow_words;
+    const value_type* entries;
+
+    static unsigned long long mix(unsigned long long h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // map a 64-bit value onto [0, n) without a division
+    static unsigned long long reduce(unsigned long long h, unsigned long long n) {
+        return (unsigned long long)(((unsigned __int128)h * n) >> 64);
+    }
+
+    // the bucket came from the high bits of h, so multiply before reducing
+    // again, or keys sharing a bucket would crowd into one range of slots
+    static unsigned long long position(unsigned long long h, unsigned pilot, unsigned long long n) {
+        return reduce((h ^ (pilot * 0x9e3779b97f4a7c15ULL)) * 0xbf58476d1ce4e5b9ULL, n);
+    }
+
+    static constexpr size_t align16(size_t n) {
+        return (n + 15) & ~size_t(15);
+    }
+
+    // the image of every empty map built without build(): the layout
+    // build() gives no entries, one zero pilot. Shared and never written.
+    struct alignas(16) EmptyImage {
+        Header header;
+        unsigned pilot;
+    };
+
+    static constexpr size_t EMPTY_SIZE = align16(align16(sizeof(Header)) + sizeof(unsigned));
+    static_assert(offsetof(EmptyImage, pilot) == align16(sizeof(Header)) && sizeof(EmptyImage) == EMPTY_SIZE,
+                  "EmptyImage must match the layout build() writes");
+
+    static constexpr EmptyImage EMPTY = {
+        {{MAGIC[0], MAGIC[1], MAGIC[2], MAGIC[3], MAGIC[4], MAGIC[5], MAGIC[6], MAGIC[7]},
+         0, 0, 1, sizeof(value_type),
+         align16(sizeof(Header)), EMPTY_SIZE, EMPTY_SIZE, EMPTY_SIZE, EMPTY_SIZE},
+        0
+    };
+
+    static unsigned char* empty_image() {
+        return const_cast<unsigned char*>(reinterpret_cast<const unsigned char*>(&EMPTY));
+    }
+
+    void attach_empty() {
+        attach(empty_image(), EMPTY_SIZE, false);
+    }
+
+    void attach(unsigned char* data, size_t size, bool is_mapped) {
+        blob = data;
+        blob_size = size;
+        mapped = is_mapped;
+        header = reinterpret_cast<const Header*>(blob);
+        pilots = reinterpret_cast<const unsigned*>(blob + header->pilots_offset);
+        slots = reinterpret_cast<const unsigned*>(blob + header->slots_offset);
+        overflow = reinterpret_cast<const unsigned*>(blob + header->overflow_offset);
+        overflow_words = (header->entries_offset - header->overflow_offset) / sizeof(unsigned);
+        entries = reinterpret_cast<const value_type*>(blob + header->entries_offset);
+    }
+
+    /**
+     * whether size bytes at data hold a header that attach() can trust:
+     * the right types, counts that agree with each other, and regions laid
+     * out as build() lays them, in order and inside the blob. Slot and
+     * overflow contents are checked by the lookups that read them.
+     */
+    static bool well_formed(const void* data, size_t size) {
+        if (size < sizeof(Header)) return false;
+        const Header* h = static_cast<const Header*>(data);
+        if (std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0 || h->entry_size != sizeof(value_type)
+            || h->total_size != size) {
+            return false;
+        }
+        // bounding the counts first keeps the offset arithmetic below exact
+        if (h->count >= OVERFLOW_BIT || h->slot_count > h->count || (h->slot_count == 0) != (h->count == 0)
+            || h->buckets != h->slot_count / KEYS_PER_BUCKET + 1) {
+            return false;
+        }
+        return h->pilots_offset == align16(sizeof(Header))
+            && h->slots_offset == align16(h->pilots_offset + h->buckets * sizeof(unsigned))
+            && h->overflow_offset == align16(h->slots_offset + h->slot_count * sizeof(unsigned))
+            && h->entries_offset >= h->overflow_offset && h->entries_offset % 16 == 0
+            && h->entries_offset <= size && size - h->entries_offset == h->count * sizeof(value_type);
+    }
+
+    void release() {
+        if (!blob) return;
+        if (blob == empty_image()) {
+            // static storage
+        } else if (mapped) {
+            munmap(blob, blob_size);
+        } else {
+            delete[] reinterpret_cast<std::max_align_t*>(blob);
+        }
+        blob = nullptr;
+    }
+
+    static unsigned char* allocate(size_t size) {
+        size_t words = (size + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+        return reinterpret_cast<unsigned char*>(new std::max_align_t[words]());
+    }
+
+    /**
+     * find a pilot for every bucket so that the m distinct hashes land on
+     * distinct positions in [0, m), placing the largest buckets first while
+     * most positions are still free.
+     * throw runtime_error if some bucket finds no pilot within its bound.
+     */
+    static void place(const unsigned long long* hashes, size_t m, size_t buckets,
+                      unsigned* pilot, unsigned* position_of) {
+        size_t* start = new size_t[buckets + 1]();
+        for (size_t i = 0; i < m; ++i) ++start[reduce(hashes[i], buckets) + 1];
+        size_t largest = 0;
+        for (size_t b = 0; b < buckets; ++b) {
+            if (start[b + 1] > largest) largest = start[b + 1];
+            start[b + 1] += start[b];
+        }
+        size_t* members = new size_t[m + 1];
+        size_t* filled = new size_t[buckets]();
+        for (size_t i = 0; i < m; ++i) {
+            size_t b = reduce(hashes[i], buckets);
+            members[start[b] + filled[b]++] = i;
+        }
+        size_t* by_size = new size_t[largest + 2]();
+        for (size_t b = 0; b < buckets; ++b) ++by_size[start[b + 1] - start[b]];
+        for (size_t size = largest; size-- > 0; ) by_size[size] += by_size[size + 1];
+        size_t* order = new size_t[buckets];
+        for (size_t b = 0; b < buckets; ++b) order[--by_size[start[b + 1] - start[b]]] = b;
+
+        bool* taken = new bool[m + 1]();
+        unsigned long long* chosen = new unsigned long long[largest + 1];
+        // even the last key, with one free position left, expects m tries;
+        // 64 m of them all failing is a chance of about e^-64 for good hashes
+        unsigned long long limit = 64ULL * m + 1024;
+        if (limit > 0xffffffffULL) limit = 0xffffffffULL;
+        bool stuck = false;
+        for (size_t i = 0; i < buckets && !stuck; ++i) {
+            size_t b = order[i];
+            size_t size = start[b + 1] - start[b];
+            if (size == 0) break;
+            for (unsigned p = 0; ; ++p) {
+                if (p == limit) {
+                    stuck = true;
+                    break;
+                }
+                size_t placed = 0;
+                for (; placed < size; ++placed) {
+                    unsigned long long pos = position(hashes[members[start[b] + placed]], p, m);
+                    bool clash = taken[pos];
+                    for (size_t k = 0; k < placed && !clash; ++k) clash = chosen[k] == pos;
+                    if (clash) break;
+                    chosen[placed] = pos;
+                }
+                if (placed < size) continue;
+                for (size_t k = 0; k < size; ++k) {
+                    taken[chosen[k]] = true;
+                    position_of[members[start[b] + k]] = chosen[k];
+                }
+                pilot[b] = p;
+                break;
+            }
+        }
+
+        delete[] chosen;
+        delete[] taken;
+        delete[] order;
+        delete[] by_size;
+        delete[] filled;
+        delete[] members;
+        delete[] start;
+        if (stuck) throw runtime_error();
+    }
+
+    template<class Map>
+    void build(const Map &map) {
+        size_t n = map.size();
+        if (n >= OVERFLOW_BIT) throw runtime_error();
+
+        Hash hash_func;
+        unsigned long long* hashes = new unsigned long long[n + 1];
+        size_t index = 0;
+        for (typename Map::const_iterator it = map.cbegin(); it != map.cend(); ++it, ++index) {
+            hashes[index] = mix(hash_func(it->first));
+        }
+
+        // collapse equal hashes; only distinct ones go into the perfect hash
+        unsigned* by_hash = new unsigned[n + 1];
+        for (size_t i = 0; i < n; ++i) by_hash[i] = i;
+        std::sort(by_hash, by_hash + n, [hashes](unsigned a, unsigned b) {
+            return hashes[a] != hashes[b] ? hashes[a] < hashes[b] : a < b;
+        });
+        unsigned long long* distinct = new unsigned long long[n + 1];
+        unsigned* target = new unsigned[n + 1];
+        size_t m = 0, overflow_size = 0;
+        for (size_t i = 0; i < n; ) {
+            size_t j = i + 1;
+            while (j < n && hashes[by_hash[j]] == hashes[by_hash[i]]) ++j;
+            distinct[m] = hashes[by_hash[i]];
+            if (j - i == 1) {
+                target[m] = by_hash[i];
+            } else {
+                target[m] = OVERFLOW_BIT | overflow_size;
+                overflow_size += 1 + (j - i);
+            }
+            ++m;
+            i = j;
+        }
+
+        size_t buckets = m / KEYS_PER_BUCKET + 1;
+        Header h;
+        std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+        h.count = n;
+        h.slot_count = m;
+        h.buckets = buckets;
+        h.entry_size = sizeof(value_type);
+        h.pilots_offset = align16(sizeof(Header));
+        h.slots_offset = align16(h.pilots_offset + buckets * sizeof(unsigned));
+        h.overflow_offset = align16(h.slots_offset + m * sizeof(unsigned));
+        h.entries_offset = align16(h.overflow_offset + overflow_size * sizeof(unsigned));
+        h.total_size = h.entries_offset + n * sizeof(value_type);
+
+        unsigned char* data = allocate(h.total_size);
+        std::memcpy(data, &h, sizeof(h));
+        unsigned* pilot = reinterpret_cast<unsigned*>(data + h.pilots_offset);
+        unsigned* slot = reinterpret_cast<unsigned*>(data + h.slots_offset);
+        unsigned* spill = reinterpret_cast<unsigned*>(data + h.overflow_offset);
+        value_type* entry = reinterpret_cast<value_type*>(data + h.entries_offset);
+
+        index = 0;
+        for (typename Map::const_iterator it = map.cbegin(); it != map.cend(); ++it, ++index) {
+            std::memcpy(&entry[index].first, &it->first, sizeof(Key));
+            std::memcpy(&entry[index].second, &it->second, sizeof(T));
+        }
+        for (size_t i = 0, k = 0; i < n; ) {
+            size_t j = i + 1;
+            while (j < n && hashes[by_hash[j]] == hashes[by_hash[i]]) ++j;
+            if (j - i > 1) {
+                spill[k++] = j - i;
+                for (size_t g = i; g < j; ++g) spill[k++] = by_hash[g];
+            }
+            i = j;
+        }
+
+        unsigned* position_of = new unsigned[m + 1];
+        auto free_scratch = [&]() {
+            delete[] position_of;
+            delete[] target;
+            delete[] distinct;
+            delete[] by_hash;
+            delete[] hashes;
+        };
+        try {
+            place(distinct, m, buckets, pilot, position_of);
+        } catch (...) {
+            free_scratch();
+            delete[] reinterpret_cast<std::max_align_t*>(data);
+            throw;
+        }
+        for (size_t i = 0; i < m; ++i) slot[position_of[i]] = target[i];
+
+        free_scratch();
+        attach(data, h.total_size, false);
+    }
+
+    const value_type* find_entry(const Key &key) const {
+        if (header->slot_count == 0) return nullptr;
+        unsigned long long h = mix(Hash()(key));
+        unsigned p = pilots[reduce(h, header->buckets)];
+        unsigned s = slots[position(h, p, header->slot_count)];
+        if (s & OVERFLOW_BIT) {
+            size_t offset = s & ~OVERFLOW_BIT;
+            if (offset >= overflow_words || overflow[offset] >= overflow_words - offset) return nullptr;
+            const unsigned* group = overflow + offset;
+            for (unsigned i = 1; i <= group[0]; ++i) {
+                if (group[i] < header->count && Equal()(entries[group[i]].first, key)) return &entries[group[i]];
+            }
+            return nullptr;
+        }
+        if (s >= header->count) return nullptr;
+        const value_type* entry = &entries[s];
+        return Equal()(entry->first, key) ? entry : nullptr;
+    }
+
+public:
+	/**
+	 * an empty frozen map.
+	 */
+	frozen_linked_hashmap() noexcept : blob(nullptr), blob_size(0), mapped(false) {
+	    attach_empty();
+	}
+
+	/**
+	 * throw runtime_error if map holds 2^31 or more elements, or, for a
+	 * hash that maps distinct keys far from uniformly, if no perfect hash
+	 * is found within its search bound.
+	 */
+	explicit frozen_linked_hashmap(const linked_hashmap<Key, T, Hash, Equal> &map)
+	        : blob(nullptr), blob_size(0), mapped(false) {
+	    build(map);
+	}
+
+	frozen_linked_hashmap(const frozen_linked_hashmap &other) : blob(nullptr), blob_size(0), mapped(false) {
+	    unsigned char* data = allocate(other.blob_size);
+	    std::memcpy(data, other.blob, other.blob_size);
+	    attach(data, other.blob_size, false);
+	}
+
+	/**
+	 * moves never allocate; other is left an empty map.
+	 */
+	frozen_linked_hashmap(frozen_linked_hashmap &&other) noexcept : blob(nullptr), blob_size(0), mapped(false) {
+	    *this = static_cast<frozen_linked_hashmap &&>(other);
+	}
+
+	frozen_linked_hashmap & operator=(const frozen_linked_hashmap &other) {
+	    if (this == &other) return *this;
+	    frozen_linked_hashmap copy(other);
+	    return *this = static_cast<frozen_linked_hashmap &&>(copy);
+	}
+
+	frozen_linked_hashmap & operator=(frozen_linked_hashmap &&other) noexcept {
+	    if (this == &other) return *this;
+	    release();
+	    attach(other.blob, other.blob_size, other.mapped);
+	    other.attach_empty();
+	    return *this;
+	}
+
+	~frozen_linked_hashmap() {
+	    release();
+	}
+
+	/**
+	 * write the map to path. The file is the in-memory image, so open()
+	 * can map it directly.
+	 * throw runtime_error if the file cannot be written.
+	 */
+	void save(const char *path) const {
+	    FILE* file = std::fopen(path, "wb");
+	    if (!file) throw runtime_error();
+	    size_t written = std::fwrite(blob, 1, blob_size, file);
+	    if (std::fclose(file) != 0 || written != blob_size) throw runtime_error();
+	}
+
+	/**
+	 * map a file written by save() read-only into memory. Pages are loaded
+	 * lazily by the kernel and shared between processes opening the same file.
+	 * throw runtime_error if the file is missing, was written for
+	 * different Key/T types, or is truncated or has a corrupt header.
+	 * A corrupt slot makes its lookups miss instead of reading out of bounds.
+	 */
+	static frozen_linked_hashmap open(const char *path) {
+	    int fd = ::open(path, O_RDONLY);
+	    if (fd < 0) throw runtime_error();
+	    struct stat st;
+	    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header)) {
+	        ::close(fd);
+	        throw runtime_error();
+	    }
+	    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	    ::close(fd);
+	    if (data == MAP_FAILED) throw runtime_error();
+
+	    if (!well_formed(data, st.st_size)) {
+	        munmap(data, st.st_size);
+	        throw runtime_error();
+	    }
+	    frozen_linked_hashmap frozen;
+	    frozen.release();
+	    frozen.attach(static_cast<unsigned char*>(data), st.st_size, true);
+	    return frozen;
+	}
+
+	/**
+	 * access specified element with bounds checking
+	 * throw index_out_of_bound if such key does not exist.
+	 */
+	const T & at(const Key &key) const {
+	    const value_type* entry = find_entry(key);
+	    if (!entry) throw index_out_of_bound();
+	    return entry->second;
+	}
+
+	const T & operator[](const Key &key) const {
+	    return at(key);
+	}
+
+	const_iterator find(const Key &key) const {
+	    const value_type* entry = find_entry(key);
+	    return entry ? entry : cend();
+	}
+
+	size_t count(const Key &key) const {
+	    return find_entry(key) ? 1 : 0;
+	}
+
+	/**
+	 * iteration is in the insertion order of the map that was frozen.
+	 */
+	const_iterator cbegin() const {
+	    return entries;
+	}
+
+	const_iterator cend() const {
+	    return entries + header->count;
+	}
+
+	bool empty() const {
+	    return header->count == 0;
+	}
+
+	size_t size() const {
+	    return header->count;
+	}
+};
+
+template<class Key, class T, class Hash, class Equal>
+frozen_linked_hashmap<Key, T, Hash, Equal> linked_hashmap<Key, T, Hash, Equal>::freeze() const {
+    return frozen_linked_hashmap<Key, T, Hash, Equal>(*this);
+}
+
+}
+
+#endif
@@ -0,0 +1,289 @@
+/**
+ * implement a linked_hashmap that stores each distinct value once
+ */
+#ifndef SJTU_INTERNED_LINKEDHASHMAP_HPP
+#define SJTU_INTERNED_LINKEDHASHMAP_HPP
+
+#include <cstddef>
+#include "linked_hashmap.hpp"
+
+namespace sjtu {
+    /**
+     * interned_linked_hashmap is for maps with many entries but few
+     * distinct values (status strings, small enum-like structs). Each
+     * distinct value is stored once in a pool with a reference count, and
+     * an entry holds only a pointer into the pool, so the values of a
+     * million entries cost as much as the few thousand distinct ones.
+     *
+     * Values are immutable in place. operator[] and at() return a
+     * reference proxy: reading it gives the pooled value, and assigning to
+     * it interns the new value and releases the old one (copy-on-write), so
+     * entries that share a value never see each other's updates.
+     *
+     * Iteration follows insertion order, as in linked_hashmap; *it gives a
+     * pair of references (first, second) into the map.
+     */
+
+template<
+	class Key,
+	class T,
+	class Hash = std::hash<Key>,
+	class Equal = std::equal_to<Key>,
+	class ValueHash = std::hash<T>,
+	class ValueEqual = std::equal_to<T>
+> class interned_linked_hashmap {
+private:
+    typedef linked_hashmap<T, size_t, ValueHash, ValueEqual> Pool;
+    // a pooled value and its reference count; pool nodes never move
+    typedef typename Pool::value_type* Handle;
+    typedef linked_hashmap<Key, Handle, Hash, Equal> Index;
+
+    Pool pool;
+    Index index;
+
+    Handle intern(const T& value) {
+        pair<typename Pool::iterator, bool> found = pool.insert(typename Pool::value_type(value, 0));
+        Handle handle = &*found.first;
+        handle->second++;
+        return handle;
+    }
+
+    void release(Handle handle) {
+        if (--handle->second == 0) pool.erase(pool.find(handle->first));
+    }
+
+    void assign(Handle& slot, const T& value) {
+        // intern first: assigning the value an entry already has must not
+        // drop its count to zero on the way
+        Handle fresh = intern(value);
+        release(slot);
+        slot = fresh;
+    }
+
+    void copy_from(const interned_linked_hashmap& other) {
+        for (typename Index::const_iterator it = other.index.cbegin(); it != other.index.cend(); ++it) {
+            index.insert(typename Index::value_type(it->first, intern(it->second->first)));
+        }
+    }
+
+    void release_all() {
+        for (typename Index::iterator it = index.begin(); it != index.end(); ++it) {
+            release(it->second);
+        }
+        index.clear();
+    }
+
+public:
+	/**
+	 * what operator[] and at() return: reads see the pooled value, and
+	 * assignment re-interns. Valid until the entry is erased.
+	 */
+	class reference {
+	    friend class interned_linked_hashmap;
+	    interned_linked_hashmap* map;
+	    Handle* slot;
+
+	    reference(interned_linked_hashmap* m, Handle* s) : map(m), slot(s) {}
+
+	public:
+		operator const T &() const {
+		    return (*slot)->first;
+		}
+
+		const T & get() const {
+		    return (*slot)->first;
+		}
+
+		reference & operator=(const T &value) {
+		    map->assign(*slot, value);
+		    return *this;
+		}
+
+		reference & operator=(const reference &other) {
+		    return *this = other.get();
+		}
+	};
+
+	struct entry {
+		const Key &first;
+		const T &second;
+	};
+
+	class const_iterator {
+	    friend class interned_linked_hashmap;
+	    typename Index::const_iterator it;
+
+	    const_iterator(typename Index::const_iterator i) : it(i) {}
+
+	public:
+		// for it->first; holds the pair that operator* builds
+		struct arrow {
+			entry value;
+			const entry* operator->() const {
+			    return &value;
+			}
+		};
+
+		const_iterator() {}
+		const_iterator(const const_iterator &other) : it(other.it) {}
+
+		const_iterator operator++(int) {
+		    const_iterator temp = *this;
+		    ++it;
+		    return temp;
+		}
+
+		const_iterator & operator++() {
+		    ++it;
+		    return *this;
+		}
+
+		const_iterator operator--(int) {
+		    const_iterator temp = *this;
+		    --it;
+		    return temp;
+		}
+
+		const_iterator & operator--() {
+		    --it;
+		    return *this;
+		}
+
+		entry operator*() const {
+		    return entry{(*it).first, (*it).second->first};
+		}
+
+		arrow operator->() const {
+		    return arrow{**this};
+		}
+
+		bool operator==(const const_iterator &rhs) const {
+		    return it == rhs.it;
+		}
+
+		bool operator!=(const const_iterator &rhs) const {
+		    return it != rhs.it;
+		}
+	};
+
+	interned_linked_hashmap() {}
+
+	interned_linked_hashmap(const interned_linked_hashmap &other) {
+	    copy_from(other);
+	}
+
+	interned_linked_hashmap & operator=(const interned_linked_hashmap &other) {
+	    if (this == &other) return *this;
+	    release_all();
+	    copy_from(other);
+	    return *this;
+	}
+
+	~interned_linked_hashmap() {
+	    release_all();
+	}
+
+	/**
+	 * access specified element with bounds checking
+	 * throw index_out_of_bound if such key does not exist.
+	 */
+	reference at(const Key &key) {
+	    typename Index::iterator it = index.find(key);
+	    if (it == index.end()) throw index_out_of_bound();
+	    return reference(this, &it->second);
+	}
+
+	const T & at(const Key &key) const {
+	    return index.at(key)->first;
+	}
+
+	/**
+	 * access specified element, inserting a default value if such key
+	 * does not exist.
+	 */
+	reference operator[](const Key &key) {
+	    typename Index::iterator it = index.find(key);
+	    if (it == index.end()) {
+	        Handle handle = intern(T());
+	        return reference(this, &index.insert(typename Index::value_type(key, handle)).first->second);
+	    }
+	    return reference(this, &it->second);
+	}
+
+	const T & operator[](const Key &key) const {
+	    return at(key);
+	}
+
+	const_iterator cbegin() const {
+	    return const_iterator(index.cbegin());
+	}
+
+	const_iterator cend() const {
+	    return const_iterator(index.cend());
+	}
+
+	const_iterator begin() const {
+	    return cbegin();
+	}
+
+	const_iterator end() const {
+	    return cend();
+	}
+
+	bool empty() const {
+	    return index.empty();
+	}
+
+	size_t size() const {
+	    return index.size();
+	}
+
+	/**
+	 * number of distinct values held in the pool.
+	 */
+	size_t distinct_values() const {
+	    return pool.size();
+	}
+
+	void clear() {
+	    release_all();
+	}
+
+	/**
+	 * insert an element.
+	 * return a pair, the first of the pair is
+	 *   the iterator to the new element (or the element that prevented the insertion),
+	 *   the second one is true if insert successfully, or false.
+	 */
+	pair<const_iterator, bool> insert(const pair<const Key, T> &value) {
+	    typename Index::iterator it = index.find(value.first);
+	    if (it != index.end()) {
+	        return pair<const_iterator, bool>(const_iterator(typename Index::const_iterator(it)), false);
+	    }
+	    Handle handle = intern(value.second);
+	    it = index.insert(typename Index::value_type(value.first, handle)).first;
+	    return pair<const_iterator, bool>(const_iterator(typename Index::const_iterator(it)), true);
+	}
+
+	/**
+	 * erase the element at pos.
+	 * throw invalid_iterator if pos is end() or points to another map.
+	 */
+	void erase(const_iterator pos) {
+	    if (pos.it.map != &index || pos == cend()) throw invalid_iterator();
+	    release(pos.it->second);
+	    index.erase(pos.it);
+	}
+
+	size_t count(const Key &key) const {
+	    return index.count(key);
+	}
+
+	const_iterator find(const Key &key) const {
+	    return const_iterator(index.find(key));
+	}
+};
+
+}
+
+#endif
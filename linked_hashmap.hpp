@@ -7,9 +7,91 @@
 // only for std::equal_to<T> and std::hash<T>
 #include <functional>
 #include <cstddef>
+// placement new, for the node slab built by compact()
+#include <new>
 #include "utility.hpp"
 #include "exceptions.hpp"
 
+/**
+ * instrumentation hook: opens a scope-long region around find_node,
+ * insert_node, erase_node and rehash, named find, insert, erase and rehash.
+ * Empty unless defined before this header, as profiling/perf_counters.hpp
+ * does.
+ */
+#ifndef SJTU_LINKED_HASHMAP_REGION
+#define SJTU_LINKED_HASHMAP_REGION(operation)
+#endif
+
+/**
+ * tracing hook: called by every public lookup and update with the map,
+ * the operation (find, count, at, access, insert, erase or clear) and the
+ * key's hash (0 for clear). Empty unless defined before this header, as
+ * profiling/trace_recorder.hpp does.
+ */
+#ifndef SJTU_LINKED_HASHMAP_TRACE
+#define SJTU_LINKED_HASHMAP_TRACE(map, operation, hash)
+#endif
+
+/**
+ * USDT probes, provider linked_hashmap, for bpftrace and the like. They
+ * are built in wherever <sys/sdt.h> exists unless
+ * SJTU_LINKED_HASHMAP_NO_USDT is defined. Each probe has a semaphore
+ * that tracers raise while attached; until then a probe costs one load
+ * and an untaken branch, and neither its arguments nor the clock are
+ * read. This needs sdt.h with semaphores, so include this header first
+ * or define _SDT_HAS_SEMAPHORES before <sys/sdt.h>; otherwise the
+ * probes are left out.
+ *   rehash_start(map, old buckets, new buckets, elements)
+ *   rehash_done(map, buckets, elements, ticks)
+ *   resize_start(map, old buckets, new buckets, elements)
+ *   resize_done(map, old buckets, new buckets, elements)
+ *   clear_start(map, elements)
+ *   clear_done(map, ticks)
+ *   evict(map, hash, weight, total weight left)
+ * rehash is the whole table at once, resize the incremental growth or
+ * shrink spread over maintain() calls. ticks are TSC cycles since the
+ * matching start on x86, and 0 elsewhere or when the done probe was
+ * attached after the start.
+ */
+#if !defined(SJTU_LINKED_HASHMAP_NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>) && (!defined(_SYS_SDT_H) || defined(_SDT_HAS_SEMAPHORES))
+#ifndef _SDT_HAS_SEMAPHORES
+#define _SDT_HAS_SEMAPHORES 1
+#endif
+#include <sys/sdt.h>
+#define SJTU_LINKED_HASHMAP_USDT
+#endif
+#endif
+
+#ifdef SJTU_LINKED_HASHMAP_USDT
+// the probe notes name these unmangled globals. Weak, not inline: inline
+// variables sharing the .probes section would share one COMDAT group.
+#define SJTU_LINKED_HASHMAP_SEMAPHORE(name) \
+    __extension__ unsigned short linked_hashmap_##name##_semaphore \
+        __attribute__((weak, unused, section(".probes"))) = 0;
+SJTU_LINKED_HASHMAP_SEMAPHORE(rehash_start)
+SJTU_LINKED_HASHMAP_SEMAPHORE(rehash_done)
+SJTU_LINKED_HASHMAP_SEMAPHORE(resize_start)
+SJTU_LINKED_HASHMAP_SEMAPHORE(resize_done)
+SJTU_LINKED_HASHMAP_SEMAPHORE(clear_start)
+SJTU_LINKED_HASHMAP_SEMAPHORE(clear_done)
+SJTU_LINKED_HASHMAP_SEMAPHORE(evict)
+#undef SJTU_LINKED_HASHMAP_SEMAPHORE
+
+#define SJTU_LINKED_HASHMAP_PROBE_ENABLED(name) __builtin_expect(linked_hashmap_##name##_semaphore, 0)
+#define SJTU_LINKED_HASHMAP_PROBE2(name, a, b) \
+    do { if (SJTU_LINKED_HASHMAP_PROBE_ENABLED(name)) STAP_PROBE2(linked_hashmap, name, a, b); } while (0)
+#define SJTU_LINKED_HASHMAP_PROBE4(name, a, b, c, d) \
+    do { if (SJTU_LINKED_HASHMAP_PROBE_ENABLED(name)) STAP_PROBE4(linked_hashmap, name, a, b, c, d); } while (0)
+// started is 0 unless the probe `done`, which reports the ticks, is attached
+#define SJTU_LINKED_HASHMAP_PROBE_CLOCK(done, started) \
+    unsigned long long started = SJTU_LINKED_HASHMAP_PROBE_ENABLED(done) ? probe_ticks() : 0
+#else
+#define SJTU_LINKED_HASHMAP_PROBE2(name, a, b)
+#define SJTU_LINKED_HASHMAP_PROBE4(name, a, b, c, d)
+#define SJTU_LINKED_HASHMAP_PROBE_CLOCK(done, started)
+#endif
+
 namespace sjtu {
     /**
      * In linked_hashmap, iteration ordering is differ from map,
@@ -21,6 +103,28 @@ namespace sjtu {
      * into the map.
      */
 
+    // the read-only snapshot that freeze() returns, in frozen_linked_hashmap.hpp
+    template<class Key, class T, class Hash, class Equal>
+    class frozen_linked_hashmap;
+
+    /**
+     * conflict policies for linked_hashmap::merge_ordered.
+     * a policy is called as policy(kept, incoming) when a key arrives that is
+     * already present; `kept` belongs to the entry that arrived first and stays
+     * in place. Any callable with this signature works as a combine function.
+     */
+    struct merge_first_wins {
+        template<class T>
+        void operator()(T &, T &) const {}
+    };
+
+    struct merge_last_wins {
+        template<class T>
+        void operator()(T &kept, T &incoming) const {
+            kept = incoming;
+        }
+    };
+
 template<
 	class Key,
 	class T,
@@ -42,77 +146,1294 @@ private:
         Node* next;
         Node* hash_prev;
         Node* hash_next;
+        unsigned long long stamp;
+        size_t hash;
+        size_t weight;
+
+        Node(const value_type& d, size_t h) : data(d), prev(nullptr), next(nullptr), hash_prev(nullptr), hash_next(nullptr),
+                                              stamp(next_stamp()), hash(h), weight(0) {}
+    };
+
+    /**
+     * One cache line of the blocked Bloom filter. Every key sets
+     * FILTER_PROBES bits inside a single block, so a negative lookup
+     * touches one line instead of walking a chain.
+     */
+    struct alignas(64) FilterBlock {
+        unsigned long long bits[8];
+    };
+
+    /**
+     * Chains longer than TREEIFY_THRESHOLD are indexed by an AVL tree
+     * ordered by full hash, as in Java 8's HashMap, so that keys piling into
+     * one bucket (for example multiples of the table size under an identity
+     * hash) cost O(log n) instead of O(n). The hash chain itself is kept, the
+     * tree is an extra index over it. Nodes whose full hashes are equal
+     * cannot be ordered without a comparator; they share one tree node
+     * through the `dup` list.
+     */
+    struct TreeNode {
+        size_t hash;
+        Node* node;
+        TreeNode* dup;
+        TreeNode* left;
+        TreeNode* right;
+        int height;
+
+        TreeNode(Node* n) : hash(n->hash), node(n), dup(nullptr), left(nullptr), right(nullptr), height(1) {}
+    };
+
+    struct Tree {
+        TreeNode* root;
+        size_t size;
+    };
+
+    /**
+     * Skip list over the nodes in key order, behind lower_bound() and the
+     * ordered iterators. Each node gets a tower of links, one level with
+     * probability 3/4, two with 3/16 and so on, so the index costs about
+     * 1.33 links per element and searches take O(log n) comparisons.
+     */
+    class OrderedIndex {
+    public:
+        static const int MAX_HEIGHT = 32;
+
+        struct Rank {
+            Node* node;
+            int height;
+            Rank** next;
+        };
+
+        bool (*less)(const Key&, const Key&);
+        Rank* heads[MAX_HEIGHT];
+        int height;
+        unsigned long long state;
+
+        OrderedIndex(bool (*compare)(const Key&, const Key&)) : less(compare), heads(), height(1),
+                                                                state(0x9E3779B97F4A7C15ULL) {}
+
+        ~OrderedIndex() {
+            clear();
+        }
+
+        Rank*& link(Rank* at, int level) {
+            return at ? at->next[level] : heads[level];
+        }
+
+        Rank* after(Rank* at, int level) const {
+            return at ? at->next[level] : heads[level];
+        }
+
+        // the last rank on each level whose key is below key (nullptr: the
+        // head), into update unless it is null; returns the one on level 0
+        Rank* search(const Key& key, Rank** update) const {
+            Rank* at = nullptr;
+            for (int level = height - 1; level >= 0; --level) {
+                Rank* next = after(at, level);
+                while (next && less(next->node->data.first, key)) {
+                    at = next;
+                    next = at->next[level];
+                }
+                if (update) update[level] = at;
+            }
+            return at;
+        }
+
+        int random_height() {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            int h = 1;
+            for (unsigned long long bits = state; h < MAX_HEIGHT && (bits & 3) == 0; bits >>= 2) h++;
+            return h;
+        }
+
+        void insert(Node* node) {
+            Rank* update[MAX_HEIGHT];
+            search(node->data.first, update);
+            int h = random_height();
+            for (; height < h; ++height) update[height] = nullptr;
+            Rank* rank = new Rank{node, h, new Rank*[h]};
+            for (int level = 0; level < h; ++level) {
+                rank->next[level] = link(update[level], level);
+                link(update[level], level) = rank;
+            }
+        }
+
+        void erase(const Node* node) {
+            Rank* update[MAX_HEIGHT];
+            search(node->data.first, update);
+            Rank* rank = after(update[0], 0);
+            for (int level = 0; level < rank->height; ++level) {
+                link(update[level], level) = rank->next[level];
+            }
+            delete[] rank->next;
+            delete rank;
+            while (height > 1 && !heads[height - 1]) height--;
+        }
+
+        Rank* lower_bound(const Key& key) const {
+            return after(search(key, nullptr), 0);
+        }
+
+        Rank* upper_bound(const Key& key) const {
+            Rank* rank = lower_bound(key);
+            if (rank && !less(key, rank->node->data.first)) rank = rank->next[0];
+            return rank;
+        }
+
+        void clear() {
+            Rank* rank = heads[0];
+            while (rank) {
+                Rank* next = rank->next[0];
+                delete[] rank->next;
+                delete rank;
+                rank = next;
+            }
+            for (int level = 0; level < MAX_HEIGHT; ++level) heads[level] = nullptr;
+            height = 1;
+        }
+    };
+
+    /**
+     * Space-Saving top-K tracker behind hot_keys(). It keeps at most
+     * `capacity` counters; a key without one takes over the counter of a
+     * least counted key, inheriting its count as the error bound, so a
+     * count never underestimates and overestimates by at most the minimum.
+     * Counters live in a stream summary (groups of equal count, in count
+     * order), which makes every offer O(1).
+     */
+    class HotKeys {
+    public:
+        struct Group;
+
+        struct Counter {
+            Key key;
+            size_t hash;
+            size_t error;
+            Group* group;
+            Counter* prev;
+            Counter* next;
+            Counter* chain;
+
+            Counter(const Key& k, size_t h, size_t e)
+                : key(k), hash(h), error(e), group(nullptr), prev(nullptr), next(nullptr), chain(nullptr) {}
+        };
+
+        struct Group {
+            size_t count;
+            Counter* first;
+            Counter* last;
+            Group* lower;
+            Group* higher;
+        };
+
+        size_t capacity;
+        size_t used;
+        Counter** index;
+        size_t index_mask;
+        Group* lowest;
+        Group* highest;
+        Equal equal_func;
+
+        HotKeys(size_t cap, const Equal& equal) : capacity(cap), used(0), lowest(nullptr), highest(nullptr),
+                                                  equal_func(equal) {
+            size_t size = 16;
+            while (size < capacity * 2) size *= 2;
+            index = new Counter*[size]();
+            index_mask = size - 1;
+        }
+
+        ~HotKeys() {
+            while (lowest) {
+                Group* group = lowest;
+                while (group->first) {
+                    Counter* counter = group->first;
+                    group->first = counter->next;
+                    delete counter;
+                }
+                lowest = group->higher;
+                delete group;
+            }
+            delete[] index;
+        }
+
+        Counter*& slot(size_t h) {
+            return index[mix_hash(h) & index_mask];
+        }
+
+        void unindex(Counter* counter) {
+            Counter** link = &slot(counter->hash);
+            while (*link != counter) link = &(*link)->chain;
+            *link = counter->chain;
+        }
+
+        // counters join a group at the back, so its front is the one
+        // longest at that count and the first to go on eviction
+        void attach(Counter* counter, Group* group) {
+            counter->group = group;
+            counter->prev = group->last;
+            counter->next = nullptr;
+            if (group->last) {
+                group->last->next = counter;
+            } else {
+                group->first = counter;
+            }
+            group->last = counter;
+        }
+
+        // take counter out of its group, dropping the group if it empties
+        void detach(Counter* counter) {
+            Group* group = counter->group;
+            if (counter->prev) {
+                counter->prev->next = counter->next;
+            } else {
+                group->first = counter->next;
+            }
+            if (counter->next) {
+                counter->next->prev = counter->prev;
+            } else {
+                group->last = counter->prev;
+            }
+            if (!group->first) drop(group);
+        }
+
+        // unlink an empty group from the summary and free it
+        void drop(Group* group) {
+            if (group->lower) {
+                group->lower->higher = group->higher;
+            } else {
+                lowest = group->higher;
+            }
+            if (group->higher) {
+                group->higher->lower = group->lower;
+            } else {
+                highest = group->lower;
+            }
+            delete group;
+        }
+
+        // a group of count just above `below` (nullptr: below everything)
+        Group* group_above(Group* below, size_t count) {
+            Group* above = below ? below->higher : lowest;
+            if (above && above->count == count) return above;
+            Group* group = new Group{count, nullptr, nullptr, below, above};
+            if (below) {
+                below->higher = group;
+            } else {
+                lowest = group;
+            }
+            if (above) {
+                above->lower = group;
+            } else {
+                highest = group;
+            }
+            return group;
+        }
+
+        // counter is alone in its group and no group holds one more
+        bool can_bump(Counter* counter) {
+            Group* group = counter->group;
+            return group->first == group->last && !(group->higher && group->higher->count == group->count + 1);
+        }
+
+        void increment(Counter* counter) {
+            Group* group = counter->group;
+            if (can_bump(counter)) {
+                group->count++;
+                return;
+            }
+            Group* next = group_above(group, group->count + 1);
+            detach(counter);
+            attach(counter, next);
+        }
 
-        Node(const value_type& d) : data(d), prev(nullptr), next(nullptr), hash_prev(nullptr), hash_next(nullptr) {}
+        void offer(const Key& key, size_t h) {
+            for (Counter* counter = slot(h); counter; counter = counter->chain) {
+                if (counter->hash == h && equal_func(counter->key, key)) {
+                    increment(counter);
+                    return;
+                }
+            }
+            Group* group;
+            Counter* storage = nullptr;
+            size_t error = 0;
+            if (used < capacity) {
+                group = group_above(nullptr, 1);
+            } else {
+                // evict the least counted key; the newcomer starts above it,
+                // in the victim's storage
+                Counter* victim = lowest->first;
+                error = lowest->count;
+                unindex(victim);
+                if (can_bump(victim)) {
+                    group = lowest;
+                    group->first = group->last = nullptr;
+                    group->count++;
+                } else {
+                    group = group_above(lowest, error + 1);
+                    detach(victim);
+                }
+                victim->~Counter();
+                storage = victim;
+                used--;
+            }
+            Counter* counter;
+            try {
+                counter = storage ? new (storage) Counter(key, h, error) : new Counter(key, h, error);
+            } catch (...) {
+                ::operator delete(storage);
+                if (!group->first) drop(group);
+                throw;
+            }
+            used++;
+            attach(counter, group);
+            Counter*& head = slot(h);
+            counter->chain = head;
+            head = counter;
+        }
     };
 
+    /**
+     * Arrival clock shared by every map of this type, so that maps filled
+     * on different threads can later be merged back in global arrival order.
+     */
+    static unsigned long long next_stamp() {
+        static unsigned long long clock = 0;
+        return __atomic_add_fetch(&clock, 1, __ATOMIC_RELAXED);
+    }
+
     Node* head;
     Node* tail;
     Node** hash_table;
     size_t table_size;
+    int table_bits;
     size_t element_count;
     Hash hash_func;
     Equal equal_func;
 
+    FilterBlock* filter;
+    size_t filter_blocks;
+    size_t filter_stale;
+
+    // per-bucket trees, allocated when the first chain grows too long
+    Tree** trees;
+
+    // per-instance keys for the bucket mixer; see bucket_of()
+    unsigned long long seed[2];
+    bool strong_hash;
+    size_t chain_record;
+
+    // incremental rehash driven by maintain(). The next table is cleared
+    // first, then old_table is drained into it; while old_table is set, a
+    // key whose old bucket is non-empty is still there, see locate()
+    Node** next_table;
+    size_t next_size;
+    size_t clear_cursor;
+    Node** old_table;
+    Tree** old_trees;
+    size_t old_size;
+    int old_bits;
+    size_t migrate_cursor;
+    FilterBlock* next_filter;
+    size_t next_filter_blocks;
+    bool auto_grow;
+
+    // weighted capacity; weights stay 0 while no weigher is set
+    size_t (*weigher)(const Key&, const T&);
+    size_t weight_limit;
+    size_t weight_total;
+
+    // traffic tracker for hot_keys(), null unless enabled
+    HotKeys* hot;
+
+    // key-order index for range scans, null unless enabled
+    OrderedIndex* ordered;
+
+    // nodes placed contiguously by compact() or the copy constructor;
+    // released once the last of them is erased
+    Node* slab;
+    size_t slab_size;
+    size_t slab_live;
+
+    static bool key_less(const Key& a, const Key& b) {
+        return a < b;
+    }
+
     static const size_t INITIAL_SIZE = 16;
+    static const size_t TREEIFY_THRESHOLD = 8;
+    static const size_t UNTREEIFY_THRESHOLD = 6;
+    // below this size a long chain means the table is too small, not that
+    // the keys collide, so grow instead of building a tree
+    static const size_t MIN_TREEIFY_CAPACITY = 64;
+    // a bucket this full under a seeded hash means someone is choosing keys
+    // against it; switch to SipHash and rehash once
+    static const size_t REKEY_THRESHOLD = 16;
+    static const size_t FILTER_BITS_PER_KEY = 10;
+    // maintain() grows ahead of insert() from this load factor, and shrinks
+    // below a quarter of it
+    static constexpr double GROW_AHEAD_LOAD = 0.5;
+    static const int FILTER_PROBES = 4;
+    // keys hashed and reduced to buckets together by the batched paths
+    static const size_t HASH_BATCH = 8;
+    // no bucket index precomputed: insert_node works it out itself
+    static const size_t ANY_BUCKET = size_t(-1);
+
+    static unsigned long long mix_hash(unsigned long long h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    static unsigned long long random_seed(const void* salt) {
+        static unsigned long long counter = 0;
+        unsigned long long x = __atomic_add_fetch(&counter, 0x9e3779b97f4a7c15ULL, __ATOMIC_RELAXED);
+        x ^= (unsigned long long)salt;
+#if defined(__x86_64__) || defined(__i386__)
+        x ^= __builtin_ia32_rdtsc();
+#endif
+        return mix_hash(x);
+    }
+
+    static unsigned long long probe_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __builtin_ia32_rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+    // 0 if the clock was not started, because no tracer was attached then
+    static unsigned long long probe_ticks_since(unsigned long long started) {
+        return started ? probe_ticks() - started : 0;
+    }
+
+    static unsigned long long rotl(unsigned long long x, int b) {
+        return (x << b) | (x >> (64 - b));
+    }
+
+    // SipHash-1-3 of a single 64-bit word
+    static unsigned long long siphash(unsigned long long m, unsigned long long k0, unsigned long long k1) {
+        unsigned long long v0 = k0 ^ 0x736f6d6570736575ULL;
+        unsigned long long v1 = k1 ^ 0x646f72616e646f6dULL;
+        unsigned long long v2 = k0 ^ 0x6c7967656e657261ULL;
+        unsigned long long v3 = k1 ^ 0x7465646279746573ULL;
+        unsigned long long b = 8ULL << 56;
+        for (int block = 0; block < 2; ++block) {
+            unsigned long long word = block == 0 ? m : b;
+            v3 ^= word;
+            v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+            v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+            v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+            v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+            v0 ^= word;
+        }
+        v2 ^= 0xff;
+        for (int round = 0; round < 3; ++round) {
+            v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+            v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+            v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+            v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+        }
+        return v0 ^ v1 ^ v2 ^ v3;
+    }
+
+    /**
+     * bucket of a cached hash in a table of 2^bits buckets.
+     * The default mixer is seeded Fibonacci hashing: one multiply, and keys
+     * with structure in their low bits (multiples of the table size under
+     * the identity std::hash) no longer share a bucket. Once a flood is
+     * detected the map switches to keyed SipHash, which cannot be attacked
+     * without knowing the per-instance key.
+     */
+    size_t bucket_of(size_t h, int bits) const {
+        unsigned long long mixed = strong_hash ? siphash(h, seed[0], seed[1])
+                                               : (h ^ seed[0]) * 0x9e3779b97f4a7c15ULL;
+        return mixed >> (64 - bits);
+    }
+
+    size_t bucket_of(size_t h) const {
+        return bucket_of(h, table_bits);
+    }
+
+#if defined(__x86_64__) && defined(__GNUC__)
+    static bool cpu_has_avx2() {
+        static const bool avx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+        return avx2;
+    }
+
+    // seeded Fibonacci bucket_of, eight hashes per iteration; returns how
+    // many hashes it did, leaving the tail to the caller
+    __attribute__((target("avx2")))
+    static size_t fibonacci_buckets_avx2(const size_t* hashes, size_t n, unsigned long long seed, int bits, size_t* out) {
+        typedef unsigned long long lanes __attribute__((vector_size(32)));
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            lanes low, high;
+            __builtin_memcpy(&low, hashes + i, sizeof(lanes));
+            __builtin_memcpy(&high, hashes + i + 4, sizeof(lanes));
+            low = ((low ^ seed) * 0x9e3779b97f4a7c15ULL) >> (64 - bits);
+            high = ((high ^ seed) * 0x9e3779b97f4a7c15ULL) >> (64 - bits);
+            __builtin_memcpy(out + i, &low, sizeof(lanes));
+            __builtin_memcpy(out + i + 4, &high, sizeof(lanes));
+        }
+        return i;
+    }
+
+    // the same with the SSE2 every x86-64 has, two hashes per vector
+    static size_t fibonacci_buckets_sse2(const size_t* hashes, size_t n, unsigned long long seed, int bits, size_t* out) {
+        typedef unsigned long long lanes __attribute__((vector_size(16)));
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            lanes pair_of;
+            __builtin_memcpy(&pair_of, hashes + i, sizeof(lanes));
+            pair_of = ((pair_of ^ seed) * 0x9e3779b97f4a7c15ULL) >> (64 - bits);
+            __builtin_memcpy(out + i, &pair_of, sizeof(lanes));
+        }
+        return i;
+    }
+#endif
+
+    /**
+     * bucket_of for n hashes at once. Under the seeded Fibonacci mixer
+     * this is a multiply and a shift per hash, done eight at a time with
+     * AVX2 where the CPU has it and with SSE2 otherwise; SipHash and other
+     * targets stay scalar.
+     */
+    void buckets_of(const size_t* hashes, size_t n, int bits, size_t* out) const {
+        size_t i = 0;
+#if defined(__x86_64__) && defined(__GNUC__)
+        if (!strong_hash) {
+            i = cpu_has_avx2() ? fibonacci_buckets_avx2(hashes, n, seed[0], bits, out)
+                               : fibonacci_buckets_sse2(hashes, n, seed[0], bits, out);
+        }
+#endif
+        for (; i < n; ++i) {
+            out[i] = bucket_of(hashes[i], bits);
+        }
+    }
+
+    static int log2_of(size_t size) {
+        int bits = 0;
+        while ((size_t(1) << bits) < size) ++bits;
+        return bits;
+    }
+
+    void rekey() {
+        strong_hash = true;
+        seed[0] = random_seed(this);
+        seed[1] = random_seed(seed);
+        rehash(table_size);
+    }
+
+    const FilterBlock& filter_block(unsigned long long mixed) const {
+        return filter[(mixed >> 40) & (filter_blocks - 1)];
+    }
+
+    static void filter_add(FilterBlock* blocks, size_t count, size_t h) {
+        unsigned long long mixed = mix_hash(h);
+        FilterBlock& block = blocks[(mixed >> 40) & (count - 1)];
+        for (int i = 0; i < FILTER_PROBES; ++i) {
+            unsigned bit = (mixed >> (9 * i)) & 511;
+            block.bits[bit >> 6] |= 1ULL << (bit & 63);
+        }
+    }
+
+    bool filter_may_contain(size_t h) const {
+        unsigned long long mixed = mix_hash(h);
+        const FilterBlock& block = filter_block(mixed);
+        // test all probes before branching, so hits stay branch-free
+        unsigned long long present = 1;
+        for (int i = 0; i < FILTER_PROBES; ++i) {
+            unsigned bit = (mixed >> (9 * i)) & 511;
+            present &= block.bits[bit >> 6] >> (bit & 63);
+        }
+        return present & 1;
+    }
+
+    /**
+     * size the filter for a full table (load factor 0.75) and re-add every key.
+     * Called on rehash, and once erased keys outnumber live ones.
+     */
+    static size_t filter_blocks_for(size_t size) {
+        size_t wanted = size * 3 / 4 * FILTER_BITS_PER_KEY / 512;
+        size_t blocks = 1;
+        while (blocks < wanted) blocks *= 2;
+        return blocks;
+    }
+
+    void rebuild_filter() {
+        size_t blocks = filter_blocks_for(table_size);
+        if (blocks != filter_blocks) {
+            delete[] filter;
+            filter = new FilterBlock[blocks];
+            filter_blocks = blocks;
+        }
+        for (size_t i = 0; i < filter_blocks; ++i) {
+            for (int j = 0; j < 8; ++j) filter[i].bits[j] = 0;
+        }
+        for (Node* current = head; current; current = current->next) {
+            filter_add(filter, filter_blocks, current->hash);
+        }
+        filter_stale = 0;
+    }
+
+    static int tree_height(TreeNode* t) {
+        return t ? t->height : 0;
+    }
+
+    static void update_height(TreeNode* t) {
+        int l = tree_height(t->left), r = tree_height(t->right);
+        t->height = (l > r ? l : r) + 1;
+    }
+
+    static TreeNode* rotate_left(TreeNode* t) {
+        TreeNode* r = t->right;
+        t->right = r->left;
+        r->left = t;
+        update_height(t);
+        update_height(r);
+        return r;
+    }
+
+    static TreeNode* rotate_right(TreeNode* t) {
+        TreeNode* l = t->left;
+        t->left = l->right;
+        l->right = t;
+        update_height(t);
+        update_height(l);
+        return l;
+    }
+
+    static TreeNode* rebalance(TreeNode* t) {
+        update_height(t);
+        int balance = tree_height(t->left) - tree_height(t->right);
+        if (balance > 1) {
+            if (tree_height(t->left->left) < tree_height(t->left->right)) t->left = rotate_left(t->left);
+            return rotate_right(t);
+        }
+        if (balance < -1) {
+            if (tree_height(t->right->right) < tree_height(t->right->left)) t->right = rotate_right(t->right);
+            return rotate_left(t);
+        }
+        return t;
+    }
+
+    static TreeNode* tree_insert(TreeNode* t, TreeNode* item) {
+        if (!t) return item;
+        if (item->hash == t->hash) {
+            item->dup = t->dup;
+            t->dup = item;
+            return t;
+        }
+        if (item->hash < t->hash) {
+            t->left = tree_insert(t->left, item);
+        } else {
+            t->right = tree_insert(t->right, item);
+        }
+        return rebalance(t);
+    }
+
+    static TreeNode* tree_remove_min(TreeNode* t, TreeNode*& min) {
+        if (!t->left) {
+            min = t;
+            return t->right;
+        }
+        t->left = tree_remove_min(t->left, min);
+        return rebalance(t);
+    }
+
+    static TreeNode* tree_erase(TreeNode* t, Node* node) {
+        if (node->hash < t->hash) {
+            t->left = tree_erase(t->left, node);
+            return rebalance(t);
+        }
+        if (node->hash > t->hash) {
+            t->right = tree_erase(t->right, node);
+            return rebalance(t);
+        }
+        if (t->node != node) {
+            TreeNode* prev = t;
+            while (prev->dup->node != node) prev = prev->dup;
+            TreeNode* gone = prev->dup;
+            prev->dup = gone->dup;
+            delete gone;
+            return t;
+        }
+        if (t->dup) {
+            TreeNode* next = t->dup;
+            t->node = next->node;
+            t->dup = next->dup;
+            delete next;
+            return t;
+        }
+        TreeNode* left = t->left;
+        TreeNode* right = t->right;
+        delete t;
+        if (!right) return left;
+        TreeNode* min = nullptr;
+        right = tree_remove_min(right, min);
+        min->left = left;
+        min->right = right;
+        return rebalance(min);
+    }
+
+    static void destroy_tree(TreeNode* t) {
+        while (t) {
+            destroy_tree(t->left);
+            TreeNode* right = t->right;
+            while (t) {
+                TreeNode* dup = t->dup;
+                delete t;
+                t = dup;
+            }
+            t = right;
+        }
+    }
+
+    Node* tree_find(const Tree* tree, const Key& key, size_t h) const {
+        TreeNode* t = tree->root;
+        while (t && t->hash != h) {
+            t = h < t->hash ? t->left : t->right;
+        }
+        for (; t; t = t->dup) {
+            if (equal_func(t->node->data.first, key)) return t->node;
+        }
+        return nullptr;
+    }
+
+    void treeify(size_t index) {
+        if (!trees) {
+            trees = new Tree*[table_size];
+            for (size_t i = 0; i < table_size; ++i) trees[i] = nullptr;
+        }
+        Tree* tree = new Tree;
+        tree->root = nullptr;
+        tree->size = 0;
+        for (Node* current = hash_table[index]; current; current = current->hash_next) {
+            tree->root = tree_insert(tree->root, new TreeNode(current));
+            tree->size++;
+        }
+        trees[index] = tree;
+    }
+
+    static void untreeify(Tree*& tree) {
+        destroy_tree(tree->root);
+        delete tree;
+        tree = nullptr;
+    }
+
+    static void clear_trees(Tree**& tree_array, size_t size) {
+        if (!tree_array) return;
+        for (size_t i = 0; i < size; ++i) {
+            if (tree_array[i]) untreeify(tree_array[i]);
+        }
+        delete[] tree_array;
+        tree_array = nullptr;
+    }
+
+    void clear_trees() {
+        clear_trees(trees, table_size);
+    }
 
     void initialize_table(size_t size) {
         table_size = size;
+        table_bits = log2_of(size);
         hash_table = new Node*[table_size];
         for (size_t i = 0; i < table_size; ++i) {
             hash_table[i] = nullptr;
         }
     }
 
-    void clear_table() {
-        if (hash_table) {
-            for (size_t i = 0; i < table_size; ++i) {
-                Node* current = hash_table[i];
-                while (current) {
-                    Node* next = current->hash_next;
-                    delete current;
-                    current = next;
+    void clear_table() {
+        abandon_rehash();
+        clear_trees();
+        if (hash_table) {
+            for (size_t i = 0; i < table_size; ++i) {
+                Node* current = hash_table[i];
+                while (current) {
+                    Node* next = current->hash_next;
+                    free_node(current);
+                    current = next;
+                }
+            }
+            delete[] hash_table;
+            hash_table = nullptr;
+        }
+    }
+
+    /**
+     * abandon an incremental rehash. The nodes stay on the list; the caller
+     * either relinks them all or is dropping them anyway.
+     */
+    void abandon_rehash() {
+        delete[] next_table;
+        next_table = nullptr;
+        if (old_table) {
+            clear_trees(old_trees, old_size);
+            delete[] old_table;
+            old_table = nullptr;
+        }
+        delete[] next_filter;
+        next_filter = nullptr;
+        next_filter_blocks = 0;
+    }
+
+    void rehash() {
+        rehash(table_size * 2);
+    }
+
+    void rehash(size_t new_size) {
+        SJTU_LINKED_HASHMAP_REGION(rehash);
+        SJTU_LINKED_HASHMAP_PROBE4(rehash_start, this, table_size, new_size, element_count);
+        SJTU_LINKED_HASHMAP_PROBE_CLOCK(rehash_done, rehash_started);
+        int new_bits = log2_of(new_size);
+        Node** new_table = new Node*[new_size];
+        for (size_t i = 0; i < new_size; ++i) {
+            new_table[i] = nullptr;
+        }
+
+        // only a map that already needed trees is worth counting chains for;
+        // elsewhere a long chain is found by the next insert into it
+        unsigned char* lengths = nullptr;
+        if (trees || old_trees) {
+            clear_trees();
+            lengths = new unsigned char[new_size]();
+        }
+        abandon_rehash();
+
+        // the cached hashes are reduced to buckets a batch at a time
+        Node* batch[HASH_BATCH];
+        size_t hashes[HASH_BATCH];
+        size_t indices[HASH_BATCH];
+        Node* current = head;
+        while (current) {
+            size_t n = 0;
+            for (; current && n < HASH_BATCH; current = current->next) {
+                batch[n] = current;
+                hashes[n++] = current->hash;
+            }
+            buckets_of(hashes, n, new_bits, indices);
+            for (size_t i = 0; i < n; ++i) {
+                size_t index = indices[i];
+                Node* node = batch[i];
+                if (lengths && lengths[index] < TREEIFY_THRESHOLD) lengths[index]++;
+                node->hash_prev = nullptr;
+                node->hash_next = new_table[index];
+                if (new_table[index]) {
+                    new_table[index]->hash_prev = node;
+                }
+                new_table[index] = node;
+            }
+        }
+
+        delete[] hash_table;
+        hash_table = new_table;
+        table_size = new_size;
+        table_bits = new_bits;
+
+        if (lengths) {
+            for (size_t i = 0; i < new_size; ++i) {
+                if (lengths[i] >= TREEIFY_THRESHOLD) treeify(i);
+            }
+            delete[] lengths;
+        }
+
+        if (filter) {
+            rebuild_filter();
+        }
+        SJTU_LINKED_HASHMAP_PROBE4(rehash_done, this, table_size, element_count, probe_ticks_since(rehash_started));
+    }
+
+    /**
+     * allocate the table (and filter) for an incremental rehash. They are
+     * cleared in budgeted steps by clear_step(), since zeroing a large
+     * table at once is the very pause maintain() is meant to avoid.
+     * The new filter fills as nodes move, so finishing needs no pass.
+     */
+    void prepare_rehash(size_t new_size) {
+        SJTU_LINKED_HASHMAP_PROBE4(resize_start, this, table_size, new_size, element_count);
+        next_table = new Node*[new_size];
+        next_size = new_size;
+        clear_cursor = 0;
+        if (filter) {
+            next_filter_blocks = filter_blocks_for(new_size);
+            next_filter = new FilterBlock[next_filter_blocks];
+        }
+    }
+
+    /**
+     * clear 64 words of the next table or filter. Returns false once done.
+     */
+    bool clear_step() {
+        if (clear_cursor < next_size) {
+            size_t end = clear_cursor + 64 < next_size ? clear_cursor + 64 : next_size;
+            for (; clear_cursor < end; ++clear_cursor) next_table[clear_cursor] = nullptr;
+            return true;
+        }
+        size_t block = clear_cursor - next_size;
+        if (!next_filter || block >= next_filter_blocks) return false;
+        size_t end = block + 8 < next_filter_blocks ? block + 8 : next_filter_blocks;
+        for (; block < end; ++block) {
+            for (int j = 0; j < 8; ++j) next_filter[block].bits[j] = 0;
+        }
+        clear_cursor = next_size + end;
+        return true;
+    }
+
+    /**
+     * switch to the cleared next table. The current one is drained one
+     * bucket at a time by maintain(), and by any insert that lands in a
+     * bucket not yet drained.
+     */
+    void begin_rehash() {
+        old_table = hash_table;
+        old_trees = trees;
+        old_size = table_size;
+        old_bits = table_bits;
+        migrate_cursor = 0;
+        trees = nullptr;
+        hash_table = next_table;
+        table_size = next_size;
+        table_bits = log2_of(next_size);
+        next_table = nullptr;
+    }
+
+    /**
+     * move the nodes of one old bucket into the new table.
+     * Returns the number of nodes moved.
+     */
+    size_t migrate_bucket(size_t index) {
+        if (old_trees && old_trees[index]) untreeify(old_trees[index]);
+        Node* current = old_table[index];
+        old_table[index] = nullptr;
+        size_t moved = 0;
+        while (current) {
+            Node* next = current->hash_next;
+            hash_link(current, bucket_of(current->hash));
+            if (next_filter) filter_add(next_filter, next_filter_blocks, current->hash);
+            current = next;
+            ++moved;
+        }
+        return moved;
+    }
+
+    void finish_rehash() {
+        SJTU_LINKED_HASHMAP_PROBE4(resize_done, this, old_size, table_size, element_count);
+        delete[] old_table;
+        old_table = nullptr;
+        delete[] old_trees;
+        old_trees = nullptr;
+        if (next_filter) {
+            delete[] filter;
+            filter = next_filter;
+            filter_blocks = next_filter_blocks;
+            next_filter = nullptr;
+            next_filter_blocks = 0;
+        }
+    }
+
+    /**
+     * the table size maintain() is heading for: double ahead of insert()'s
+     * threshold, halve once erases leave the table mostly empty, and in
+     * either case land at a load factor of at most 3/8.
+     */
+    size_t wanted_size() const {
+        bool grow = element_count >= table_size * GROW_AHEAD_LOAD;
+        bool shrink = element_count < table_size * GROW_AHEAD_LOAD / 4 && table_size > INITIAL_SIZE;
+        if (!grow && !shrink) return table_size;
+        size_t size = INITIAL_SIZE;
+        while (element_count * 8 > size * 3) size *= 2;
+        return size;
+    }
+
+    /**
+     * the bucket array, tree array and index that hold hash h. An insert
+     * drains its old bucket first, so an old bucket that still has nodes
+     * holds every key that maps to it.
+     */
+    Node** locate(size_t h, size_t& index, Tree**& tree_array) const {
+        if (old_table) {
+            index = bucket_of(h, old_bits);
+            if (old_table[index]) {
+                tree_array = old_trees;
+                return old_table;
+            }
+        }
+        index = bucket_of(h);
+        tree_array = trees;
+        return hash_table;
+    }
+
+    Node* find_node(const Key& key) const {
+        return find_node(key, hash_func(key));
+    }
+
+    Node* find_node(const Key& key, size_t h) const {
+        SJTU_LINKED_HASHMAP_REGION(find);
+        size_t index;
+        Tree** tree_array;
+        Node* current = locate(h, index, tree_array)[index];
+        return find_in_bucket(current, tree_array ? tree_array[index] : nullptr, key, h);
+    }
+
+    Node* find_in_bucket(Node* current, Tree* tree, const Key& key, size_t h) const {
+        // the filter only saves the walk into cold nodes; empty buckets are cheaper
+        if (current && filter && !filter_may_contain(h)) {
+            return nullptr;
+        }
+        if (tree) {
+            return tree_find(tree, key, h);
+        }
+        while (current) {
+            if (current->hash == h && equal_func(current->data.first, key)) {
+                return current;
+            }
+            current = current->hash_next;
+        }
+        return nullptr;
+    }
+
+    /**
+     * find_node for up to HASH_BATCH keys: they are hashed and reduced to
+     * buckets together, every bucket and then every chain head is
+     * prefetched, and only then are the chains walked, so the group's
+     * cache misses overlap. Returns how many were found.
+     */
+    size_t find_group(const Key* keys, size_t group, Node** nodes) const {
+        // zeroed only so that -Wmaybe-uninitialized can tell buckets_of() reads written lanes
+        size_t hashes[HASH_BATCH] = {};
+        size_t indices[HASH_BATCH];
+        Node* heads[HASH_BATCH];
+        for (size_t i = 0; i < group; ++i) {
+            hashes[i] = hash_func(keys[i]);
+            SJTU_LINKED_HASHMAP_TRACE(this, find, hashes[i]);
+        }
+        if (old_table) {
+            // mid-migration a key may sit in either table; see locate()
+            for (size_t i = 0; i < group; ++i) {
+                nodes[i] = find_node(keys[i], hashes[i]);
+            }
+        } else {
+            buckets_of(hashes, group, table_bits, indices);
+            for (size_t i = 0; i < group; ++i) {
+                __builtin_prefetch(hash_table + indices[i]);
+            }
+            for (size_t i = 0; i < group; ++i) {
+                heads[i] = hash_table[indices[i]];
+                if (heads[i]) __builtin_prefetch(heads[i]);
+            }
+            for (size_t i = 0; i < group; ++i) {
+                nodes[i] = find_in_bucket(heads[i], trees ? trees[indices[i]] : nullptr, keys[i], hashes[i]);
+            }
+        }
+        size_t found = 0;
+        for (size_t i = 0; i < group; ++i) {
+            if (nodes[i]) found++;
+        }
+        return found;
+    }
+
+    /**
+     * grow the table so that `extra` more elements fit without a rehash.
+     */
+    void reserve_for(size_t extra) {
+        size_t new_size = table_size;
+        while (element_count + extra >= new_size * 0.75) {
+            new_size *= 2;
+        }
+        if (new_size != table_size) {
+            rehash(new_size);
+        }
+    }
+
+    /**
+     * push node onto bucket index of the current table, treeifying the
+     * chain if it got long enough. Returns the chain length (counted up to
+     * TREEIFY_THRESHOLD) or the tree size.
+     */
+    size_t hash_link(Node* node, size_t index) {
+        node->hash_prev = nullptr;
+        node->hash_next = hash_table[index];
+        if (hash_table[index]) {
+            hash_table[index]->hash_prev = node;
+        }
+        hash_table[index] = node;
+
+        if (trees && trees[index]) {
+            Tree* tree = trees[index];
+            tree->root = tree_insert(tree->root, new TreeNode(node));
+            return ++tree->size;
+        }
+        size_t length = 0;
+        for (Node* current = hash_table[index]; current && length < TREEIFY_THRESHOLD; current = current->hash_next) {
+            length++;
+        }
+        // in a small table a long chain calls for growing instead, unless
+        // growth is left to maintain()
+        if (length >= TREEIFY_THRESHOLD && (table_size >= MIN_TREEIFY_CAPACITY || !auto_grow)) {
+            treeify(index);
+        }
+        return length;
+    }
+
+    void link_node(Node* node) {
+        link_node(node, bucket_of(node->hash));
+    }
+
+    // index is bucket_of(node->hash) in the current table
+    void link_node(Node* node, size_t index) {
+        if (!head) {
+            head = node;
+            tail = node;
+        } else {
+            tail->next = node;
+            node->prev = tail;
+            tail = node;
+        }
+
+        if (old_table) {
+            size_t old_index = bucket_of(node->hash, old_bits);
+            if (old_table[old_index]) migrate_bucket(old_index);
+            if (next_filter) filter_add(next_filter, next_filter_blocks, node->hash);
+        }
+
+        size_t length = hash_link(node, index);
+        element_count++;
+        weight_total += node->weight;
+        if (ordered) ordered->insert(node);
+
+        if (filter) {
+            filter_add(filter, filter_blocks, node->hash);
+        }
+
+        if (length > chain_record) chain_record = length;
+        if (trees && trees[index]) {
+            if (length > REKEY_THRESHOLD && !strong_hash) rekey();
+        } else if (length >= TREEIFY_THRESHOLD) {
+            rehash();
+        }
+    }
+
+    bool in_slab(const Node* node) const {
+        std::less<const Node*> before;
+        return slab && !before(node, slab) && before(node, slab + slab_size);
+    }
+
+    void free_node(Node* node) {
+        if (!in_slab(node)) {
+            delete node;
+            return;
+        }
+        node->~Node();
+        if (--slab_live == 0) {
+            ::operator delete(slab);
+            slab = nullptr;
+            slab_size = 0;
+        }
+    }
+
+    // raw storage for n nodes in a row; the caller constructs them
+    static Node* allocate_slab(size_t n) {
+        return static_cast<Node*>(::operator new(n * sizeof(Node)));
+    }
+
+    /**
+     * append copies of other's elements, keeping their stamps and cached
+     * hashes, in one slab in list order. The table must already be large
+     * enough and the map empty.
+     */
+    void copy_from(const linked_hashmap& other) {
+        strong_hash = other.strong_hash;
+        auto_grow = other.auto_grow;
+        weigher = other.weigher;
+        weight_limit = other.weight_limit;
+        // the setting is copied, not the counts: those describe other's traffic
+        enable_hot_keys(other.hot ? other.hot->capacity : 0);
+        enable_ordered_index(other.ordered ? other.ordered->less : nullptr);
+        if (other.filter) {
+            rebuild_filter();
+        }
+        if (!other.element_count) return;
+        slab = allocate_slab(other.element_count);
+        slab_size = other.element_count;
+        for (Node* current = other.head; current; current = current->next) {
+            Node* node;
+            try {
+                node = new (slab + slab_live) Node(*current);
+            } catch (...) {
+                if (!slab_live) {
+                    ::operator delete(slab);
+                    slab = nullptr;
+                    slab_size = 0;
                 }
+                throw;
             }
-            delete[] hash_table;
-            hash_table = nullptr;
+            slab_live++;
+            node->prev = node->next = nullptr;
+            node->hash_prev = node->hash_next = nullptr;
+            link_node(node);
         }
     }
 
-    void rehash() {
-        size_t new_size = table_size * 2;
-        Node** new_table = new Node*[new_size];
-        for (size_t i = 0; i < new_size; ++i) {
-            new_table[i] = nullptr;
-        }
+    size_t weigh(const value_type& value) const {
+        return weigher ? weigher(value.first, value.second) : 0;
+    }
 
-        Node* current = head;
-        while (current) {
-            size_t index = hash_func(current->data.first) % new_size;
-            current->hash_prev = nullptr;
-            current->hash_next = new_table[index];
-            if (new_table[index]) {
-                new_table[index]->hash_prev = current;
+    bool over_weight() const {
+        return weight_limit && weight_total > weight_limit;
+    }
+
+    /**
+     * evict from the head of the order list until the map fits its weight
+     * limit again. keep, the entry being inserted or reweighed, is skipped.
+     */
+    void evict_over_weight(const Node* keep) {
+        Node* victim = head;
+        while (over_weight() && victim) {
+            Node* next = victim->next;
+            if (victim != keep) {
+                SJTU_LINKED_HASHMAP_PROBE4(evict, this, victim->hash, victim->weight, weight_total - victim->weight);
+                erase_node(victim);
             }
-            new_table[index] = current;
-            current = current->next;
+            victim = next;
         }
+    }
 
-        delete[] hash_table;
-        hash_table = new_table;
-        table_size = new_size;
+    /**
+     * the caller has checked that the value fits the weight limit on its own.
+     * index, unless ANY_BUCKET, is bucket_of(h) in the current table, as a
+     * batch has already computed it; a growing rehash here makes it stale.
+     */
+    Node* insert_node(const value_type& value, size_t h, size_t weight = 0, size_t index = ANY_BUCKET) {
+        SJTU_LINKED_HASHMAP_REGION(insert);
+        if (auto_grow && element_count >= table_size * 0.75) {
+            rehash();
+            index = ANY_BUCKET;
+        }
+        Node* node = new Node(value, h);
+        node->weight = weight;
+        link_node(node, index == ANY_BUCKET ? bucket_of(h) : index);
+        if (over_weight()) evict_over_weight(node);
+        return node;
     }
 
-    Node* find_node(const Key& key) const {
-        size_t index = hash_func(key) % table_size;
-        Node* current = hash_table[index];
-        while (current) {
-            if (equal_func(current->data.first, key)) {
-                return current;
-            }
-            current = current->hash_next;
+    void erase_node(Node* node) {
+        SJTU_LINKED_HASHMAP_REGION(erase);
+        remove_from_hash(node);
+        remove_from_list(node);
+        if (ordered) ordered->erase(node);
+        weight_total -= node->weight;
+        free_node(node);
+        element_count--;
+
+        // Bloom bits cannot be cleared; rebuild once stale keys dominate
+        if (filter && ++filter_stale > element_count) {
+            rebuild_filter();
         }
-        return nullptr;
     }
 
     void remove_from_list(Node* node) {
@@ -129,15 +1450,23 @@ private:
     }
 
     void remove_from_hash(Node* node) {
-        size_t index = hash_func(node->data.first) % table_size;
+        size_t index;
+        Tree** tree_array;
+        Node** buckets = locate(node->hash, index, tree_array);
         if (node->hash_prev) {
             node->hash_prev->hash_next = node->hash_next;
         } else {
-            hash_table[index] = node->hash_next;
+            buckets[index] = node->hash_next;
         }
         if (node->hash_next) {
             node->hash_next->hash_prev = node->hash_prev;
         }
+
+        if (tree_array && tree_array[index]) {
+            Tree* tree = tree_array[index];
+            tree->root = tree_erase(tree->root, node);
+            if (--tree->size <= UNTREEIFY_THRESHOLD) untreeify(tree_array[index]);
+        }
     }
 
 public:
@@ -175,6 +1504,7 @@ public:
 		iterator() : node(nullptr), map(nullptr) {}
 		iterator(Node* n, const linked_hashmap* m) : node(n), map(m) {}
 		iterator(const iterator &other) : node(other.node), map(other.map) {}
+		iterator & operator=(const iterator &other) = default;
 		/**
 		 * TODO iter++
 		 */
@@ -272,6 +1602,7 @@ public:
 		const_iterator(const Node* n, const linked_hashmap* m) : node(n), map(m) {}
 		const_iterator(const const_iterator &other) : node(other.node), map(other.map) {}
 		const_iterator(const iterator &other) : node(other.node), map(other.map) {}
+		const_iterator & operator=(const const_iterator &other) = default;
 
 		const_iterator operator++(int) {
 		    if (!map) throw invalid_iterator();
@@ -347,40 +1678,58 @@ public:
 	/**
 	 * TODO two constructors
 	 */
-	linked_hashmap() : head(nullptr), tail(nullptr), hash_table(nullptr), table_size(0), element_count(0) {
+	linked_hashmap() : head(nullptr), tail(nullptr), hash_table(nullptr), table_size(0), element_count(0),
+	                   filter(nullptr), filter_blocks(0), filter_stale(0), trees(nullptr),
+	                   strong_hash(false), chain_record(0),
+	                   next_table(nullptr), next_size(0), clear_cursor(0), old_table(nullptr), old_trees(nullptr),
+	                   old_size(0), old_bits(0), migrate_cursor(0), next_filter(nullptr), next_filter_blocks(0), auto_grow(true),
+	                   weigher(nullptr), weight_limit(0), weight_total(0), hot(nullptr),
+	                   ordered(nullptr), slab(nullptr), slab_size(0), slab_live(0) {
+	    seed[0] = random_seed(this);
+	    seed[1] = random_seed(seed);
 	    initialize_table(INITIAL_SIZE);
 	}
 
-	linked_hashmap(const linked_hashmap &other) : head(nullptr), tail(nullptr), hash_table(nullptr), table_size(0), element_count(0) {
+	/**
+	 * the copy's nodes sit in one slab in list order, as after compact().
+	 * The slab is freed only with its last node, so a copy that churns
+	 * keeps the whole O(n) block while it holds even one of its nodes;
+	 * slab_nodes() tells how many are left, and compact() releases it.
+	 */
+	linked_hashmap(const linked_hashmap &other) : head(nullptr), tail(nullptr), hash_table(nullptr), table_size(0), element_count(0),
+	                   filter(nullptr), filter_blocks(0), filter_stale(0), trees(nullptr),
+	                   strong_hash(false), chain_record(0),
+	                   next_table(nullptr), next_size(0), clear_cursor(0), old_table(nullptr), old_trees(nullptr),
+	                   old_size(0), old_bits(0), migrate_cursor(0), next_filter(nullptr), next_filter_blocks(0), auto_grow(true),
+	                   weigher(nullptr), weight_limit(0), weight_total(0), hot(nullptr),
+	                   ordered(nullptr), slab(nullptr), slab_size(0), slab_live(0) {
+	    seed[0] = random_seed(this);
+	    seed[1] = random_seed(seed);
 	    initialize_table(other.table_size);
 	    hash_func = other.hash_func;
 	    equal_func = other.equal_func;
 
-	    Node* current = other.head;
-	    while (current) {
-	        insert(current->data);
-	        current = current->next;
-	    }
+	    copy_from(other);
 	}
 
 	/**
 	 * TODO assignment operator
+	 * Like the copy constructor, puts the elements in one slab.
 	 */
 	linked_hashmap & operator=(const linked_hashmap &other) {
 	    if (this == &other) return *this;
 
 	    clear();
 	    clear_table();
+	    delete[] filter;
+	    filter = nullptr;
+	    filter_blocks = 0;
 
 	    initialize_table(other.table_size);
 	    hash_func = other.hash_func;
 	    equal_func = other.equal_func;
 
-	    Node* current = other.head;
-	    while (current) {
-	        insert(current->data);
-	        current = current->next;
-	    }
+	    copy_from(other);
 
 	    return *this;
 	}
@@ -391,6 +1740,9 @@ public:
 	~linked_hashmap() {
 	    clear();
 	    clear_table();
+	    delete[] filter;
+	    delete hot;
+	    delete ordered;
 	}
 
 	/**
@@ -400,13 +1752,18 @@ public:
 	 * If no such element exists, an exception of type `index_out_of_bound'
 	 */
 	T & at(const Key &key) {
-	    Node* node = find_node(key);
+	    size_t h = hash_func(key);
+	    SJTU_LINKED_HASHMAP_TRACE(this, at, h);
+	    if (hot) hot->offer(key, h);
+	    Node* node = find_node(key, h);
 	    if (!node) throw index_out_of_bound();
 	    return node->data.second;
 	}
 
 	const T & at(const Key &key) const {
-	    Node* node = find_node(key);
+	    size_t h = hash_func(key);
+	    SJTU_LINKED_HASHMAP_TRACE(this, at, h);
+	    Node* node = find_node(key, h);
 	    if (!node) throw index_out_of_bound();
 	    return node->data.second;
 	}
@@ -418,14 +1775,18 @@ public:
 	 *   performing an insertion if such key does not already exist.
 	 */
 	T & operator[](const Key &key) {
-	    Node* node = find_node(key);
+	    size_t h = hash_func(key);
+	    SJTU_LINKED_HASHMAP_TRACE(this, access, h);
+	    if (hot) hot->offer(key, h);
+	    Node* node = find_node(key, h);
 	    if (node) {
 	        return node->data.second;
 	    }
 
-	    value_type new_pair(key, T());
-	    insert(new_pair);
-	    return find_node(key)->data.second;
+	    value_type value(key, T());
+	    size_t weight = weigh(value);
+	    if (weight_limit && weight > weight_limit) throw runtime_error();
+	    return insert_node(value, h, weight)->data.second;
 	}
 
 	/**
@@ -477,19 +1838,30 @@ public:
 	 * clears the contents
 	 */
 	void clear() {
+	    SJTU_LINKED_HASHMAP_TRACE(this, clear, 0);
+	    SJTU_LINKED_HASHMAP_PROBE2(clear_start, this, element_count);
+	    SJTU_LINKED_HASHMAP_PROBE_CLOCK(clear_done, clear_started);
 	    Node* current = head;
 	    while (current) {
 	        Node* next = current->next;
-	        delete current;
+	        free_node(current);
 	        current = next;
 	    }
 	    head = nullptr;
 	    tail = nullptr;
 	    element_count = 0;
+	    weight_total = 0;
+	    if (ordered) ordered->clear();
 
+	    abandon_rehash();
+	    clear_trees();
 	    for (size_t i = 0; i < table_size; ++i) {
 	        hash_table[i] = nullptr;
 	    }
+	    if (filter) {
+	        rebuild_filter();
+	    }
+	    SJTU_LINKED_HASHMAP_PROBE2(clear_done, this, probe_ticks_since(clear_started));
 	}
 
 	/**
@@ -499,37 +1871,20 @@ public:
 	 *   the second one is true if insert successfully, or false.
 	 */
 	pair<iterator, bool> insert(const value_type &value) {
-	    Node* existing = find_node(value.first);
+	    size_t h = hash_func(value.first);
+	    SJTU_LINKED_HASHMAP_TRACE(this, insert, h);
+	    if (hot) hot->offer(value.first, h);
+	    Node* existing = find_node(value.first, h);
 	    if (existing) {
 	        return pair<iterator, bool>(iterator(existing, this), false);
 	    }
-
-	    if (element_count >= table_size * 0.75) {
-	        rehash();
-	    }
-
-	    Node* new_node = new Node(value);
-
-	    // Add to linked list
-	    if (!head) {
-	        head = new_node;
-	        tail = new_node;
-	    } else {
-	        tail->next = new_node;
-	        new_node->prev = tail;
-	        tail = new_node;
-	    }
-
-	    // Add to hash table
-	    size_t index = hash_func(value.first) % table_size;
-	    new_node->hash_next = hash_table[index];
-	    if (hash_table[index]) {
-	        hash_table[index]->hash_prev = new_node;
+	    // an entry heavier than the whole budget is rejected
+	    size_t weight = weigh(value);
+	    if (weight_limit && weight > weight_limit) {
+	        return pair<iterator, bool>(end(), false);
 	    }
-	    hash_table[index] = new_node;
 
-	    element_count++;
-	    return pair<iterator, bool>(iterator(new_node, this), true);
+	    return pair<iterator, bool>(iterator(insert_node(value, h, weight), this), true);
 	}
 
 	/**
@@ -540,11 +1895,15 @@ public:
 	void erase(iterator pos) {
 	    if (!pos.node || pos.map != this) throw invalid_iterator();
 
-	    Node* node = pos.node;
-	    remove_from_hash(node);
-	    remove_from_list(node);
-	    delete node;
-	    element_count--;
+	    SJTU_LINKED_HASHMAP_TRACE(this, erase, pos.node->hash);
+	    erase_node(pos.node);
+	}
+
+	void erase(const_iterator pos) {
+	    if (!pos.node || pos.map != this) throw invalid_iterator();
+
+	    SJTU_LINKED_HASHMAP_TRACE(this, erase, pos.node->hash);
+	    erase_node(const_cast<Node*>(pos.node));
 	}
 
 	/**
@@ -554,7 +1913,9 @@ public:
 	 *     since this container does not allow duplicates.
 	 */
 	size_t count(const Key &key) const {
-	    return find_node(key) ? 1 : 0;
+	    size_t h = hash_func(key);
+	    SJTU_LINKED_HASHMAP_TRACE(this, count, h);
+	    return find_node(key, h) ? 1 : 0;
 	}
 
 	/**
@@ -564,14 +1925,630 @@ public:
 	 *   If no such element is found, past-the-end (see end()) iterator is returned.
 	 */
 	iterator find(const Key &key) {
-	    Node* node = find_node(key);
+	    size_t h = hash_func(key);
+	    SJTU_LINKED_HASHMAP_TRACE(this, find, h);
+	    if (hot) hot->offer(key, h);
+	    Node* node = find_node(key, h);
 	    return node ? iterator(node, this) : end();
 	}
 
 	const_iterator find(const Key &key) const {
-	    Node* node = find_node(key);
+	    size_t h = hash_func(key);
+	    SJTU_LINKED_HASHMAP_TRACE(this, find, h);
+	    Node* node = find_node(key, h);
 	    return node ? const_iterator(node, this) : cend();
 	}
+
+	/**
+	 * count() for n keys at once. found[i], if found is given, says
+	 * whether keys[i] is present; returns how many are.
+	 * Keys are hashed and bucketed in groups of eight whose cache misses
+	 * overlap, which is faster than n calls for tables beyond the cache.
+	 */
+	size_t count_batch(const Key *keys, size_t n, bool *found = nullptr) const {
+	    Node* nodes[HASH_BATCH];
+	    size_t total = 0;
+	    for (size_t base = 0; base < n; base += HASH_BATCH) {
+	        size_t group = n - base < HASH_BATCH ? n - base : HASH_BATCH;
+	        total += find_group(keys + base, group, nodes);
+	        if (found) {
+	            for (size_t i = 0; i < group; ++i) found[base + i] = nodes[i] != nullptr;
+	        }
+	    }
+	    return total;
+	}
+
+	/**
+	 * start loading the bucket slot and chain head a lookup of key will
+	 * touch, without waiting for them. For streams handled one key at a
+	 * time: prefetch a few keys ahead of the one being looked up, so the
+	 * misses overlap. Does nothing mid-migration.
+	 */
+	void prefetch(const Key &key) const {
+	    if (old_table) return;
+	    Node* const* slot = hash_table + bucket_of(hash_func(key));
+	    __builtin_prefetch(slot);
+	    if (*slot) __builtin_prefetch(*slot);
+	}
+
+	/**
+	 * find() for n keys at once, batched as count_batch(). values[i] points
+	 * at the value of keys[i], or is null if it is absent; returns how many
+	 * were found.
+	 */
+	size_t find_batch(const Key *keys, size_t n, T **values) {
+	    Node* nodes[HASH_BATCH];
+	    size_t total = 0;
+	    for (size_t base = 0; base < n; base += HASH_BATCH) {
+	        size_t group = n - base < HASH_BATCH ? n - base : HASH_BATCH;
+	        total += find_group(keys + base, group, nodes);
+	        for (size_t i = 0; i < group; ++i) {
+	            values[base + i] = nodes[i] ? &nodes[i]->data.second : nullptr;
+	        }
+	    }
+	    return total;
+	}
+
+	size_t find_batch(const Key *keys, size_t n, const T **values) const {
+	    Node* nodes[HASH_BATCH];
+	    size_t total = 0;
+	    for (size_t base = 0; base < n; base += HASH_BATCH) {
+	        size_t group = n - base < HASH_BATCH ? n - base : HASH_BATCH;
+	        total += find_group(keys + base, group, nodes);
+	        for (size_t i = 0; i < group; ++i) {
+	            values[base + i] = nodes[i] ? &nodes[i]->data.second : nullptr;
+	        }
+	    }
+	    return total;
+	}
+
+	/**
+	 * insert n elements in order, each as insert() would: a key already
+	 * present (or earlier in the batch) is skipped, and so is an entry
+	 * heavier than the weight budget. Returns how many were inserted.
+	 * With auto-grow on, the table is sized for all n first, so the batch
+	 * causes at most one rehash.
+	 */
+	size_t insert_batch(const value_type *values, size_t n) {
+	    if (auto_grow) reserve_for(n);
+	    size_t hashes[HASH_BATCH];
+	    size_t indices[HASH_BATCH];
+	    size_t inserted = 0;
+	    for (size_t base = 0; base < n; base += HASH_BATCH) {
+	        size_t group = n - base < HASH_BATCH ? n - base : HASH_BATCH;
+	        for (size_t i = 0; i < group; ++i) {
+	            hashes[i] = hash_func(values[base + i].first);
+	            SJTU_LINKED_HASHMAP_TRACE(this, insert, hashes[i]);
+	        }
+	        // the indices serve the lookup and the link while the bucket
+	        // function stands; an insert that rehashes or rekeys changes it
+	        int bits = table_bits;
+	        bool strong = strong_hash;
+	        bool indexed = !old_table;
+	        if (indexed) {
+	            buckets_of(hashes, group, table_bits, indices);
+	            for (size_t i = 0; i < group; ++i) {
+	                __builtin_prefetch(hash_table + indices[i]);
+	            }
+	        }
+	        for (size_t i = 0; i < group; ++i) {
+	            const value_type& value = values[base + i];
+	            indexed = indexed && table_bits == bits && strong_hash == strong && !old_table;
+	            size_t index = indexed ? indices[i] : ANY_BUCKET;
+	            Node* existing = indexed ? find_in_bucket(hash_table[index], trees ? trees[index] : nullptr, value.first, hashes[i])
+	                                     : find_node(value.first, hashes[i]);
+	            if (existing) continue;
+	            size_t weight = weigh(value);
+	            if (weight_limit && weight > weight_limit) continue;
+	            insert_node(value, hashes[i], weight, index);
+	            inserted++;
+	        }
+	    }
+	    return inserted;
+	}
+
+	/**
+	 * turn the Bloom filter in front of the table on or off.
+	 * With the filter on, most lookups of absent keys (count, find, insert
+	 * of a new key) are answered from one cache line without walking a
+	 * chain, at a cost of FILTER_BITS_PER_KEY bits per slot of the table.
+	 */
+	void enable_filter(bool on = true) {
+	    if (on && !filter) {
+	        rebuild_filter();
+	    } else if (!on && filter) {
+	        delete[] filter;
+	        filter = nullptr;
+	        filter_blocks = 0;
+	        delete[] next_filter;
+	        next_filter = nullptr;
+	        next_filter_blocks = 0;
+	    }
+	}
+
+	bool filter_enabled() const {
+	    return filter != nullptr;
+	}
+
+	/**
+	 * idle-time upkeep, so that insert() does not have to stop for a rehash
+	 * at the worst moment. Each call does at most about `budget` units of
+	 * work, one unit per bucket visited, node moved, or 64 words of a new
+	 * table cleared:
+	 *   - grows the table once the load factor reaches GROW_AHEAD_LOAD,
+	 *     ahead of the 0.75 at which insert() would rehash on its own;
+	 *   - shrinks it once erases leave it below a quarter of that;
+	 *   - moves the nodes across a few buckets per call (incremental
+	 *     rehash). Lookups, inserts and erases stay valid in between.
+	 * Returns true while there is work left for another call.
+	 */
+	bool maintain(size_t budget) {
+	    if (!old_table) {
+	        if (!next_table) {
+	            size_t size = wanted_size();
+	            if (size == table_size) return false;
+	            prepare_rehash(size);
+	        }
+	        for (; budget > 0; --budget) {
+	            if (!clear_step()) break;
+	        }
+	        if (budget == 0) return true;
+	        begin_rehash();
+	    }
+	    while (budget > 0 && migrate_cursor < old_size) {
+	        size_t cost = 1 + migrate_bucket(migrate_cursor++);
+	        budget -= cost < budget ? cost : budget;
+	    }
+	    if (migrate_cursor < old_size) return true;
+	    finish_rehash();
+	    return wanted_size() != table_size;
+	}
+
+	/**
+	 * move every element into one contiguous slab in insertion order and
+	 * rebuild the buckets, so that iteration, copies and rehashes walk
+	 * memory sequentially again after long churn. O(n), copying each
+	 * element once; the old nodes are freed. Stamps and weights are kept.
+	 * Invalidates all iterators and references into the map (which is
+	 * why maintain() never calls it); a rehash in progress is finished.
+	 */
+	void compact() {
+	    if (!element_count) return;
+	    Node* fresh = allocate_slab(element_count);
+	    size_t placed = 0;
+	    try {
+	        for (Node* current = head; current; current = current->next) {
+	            new (fresh + placed) Node(*current);
+	            placed++;
+	        }
+	    } catch (...) {
+	        while (placed > 0) fresh[--placed].~Node();
+	        ::operator delete(fresh);
+	        throw;
+	    }
+
+	    // old nodes point at their copies through hash_next, which the
+	    // rehash below rebuilds anyway
+	    Node* current = head;
+	    for (size_t i = 0; i < placed; ++i, current = current->next) {
+	        fresh[i].prev = i > 0 ? fresh + i - 1 : nullptr;
+	        fresh[i].next = i + 1 < placed ? fresh + i + 1 : nullptr;
+	        current->hash_next = fresh + i;
+	    }
+	    if (ordered) {
+	        for (typename OrderedIndex::Rank* rank = ordered->heads[0]; rank; rank = rank->next[0]) {
+	            rank->node = rank->node->hash_next;
+	        }
+	    }
+	    current = head;
+	    while (current) {
+	        Node* next = current->next;
+	        free_node(current);
+	        current = next;
+	    }
+
+	    slab = fresh;
+	    slab_size = slab_live = placed;
+	    head = fresh;
+	    tail = fresh + placed - 1;
+	    rehash(table_size);
+	}
+
+	/**
+	 * how many elements still sit in the slab of the last compact() or
+	 * copy; compared with size(), how much churn there has been since.
+	 */
+	size_t slab_nodes() const {
+	    return slab_live;
+	}
+
+	/**
+	 * with automatic growth off, insert() never rehashes the whole table;
+	 * the table only grows in maintain() (or through reserve-style bulk
+	 * operations such as merge_ordered). Long chains are still treeified,
+	 * so lookups degrade gracefully if maintain() falls behind.
+	 */
+	void enable_auto_grow(bool on = true) {
+	    auto_grow = on;
+	}
+
+	bool auto_grow_enabled() const {
+	    return auto_grow;
+	}
+
+	/**
+	 * weighted capacity. weigher(key, value) gives the cost of an entry,
+	 * for example its size in bytes; with a max weight set, an insert that
+	 * takes the total over it evicts entries from the head of the order
+	 * list (the oldest) until the map fits, and an entry heavier than the
+	 * whole budget is not inserted: insert() returns (end(), false) and
+	 * operator[] throws runtime_error.
+	 * Weights are taken on insertion. After changing a value in place
+	 * (map[key] = bigger), call reweigh() to keep the total exact.
+	 * A max weight of 0 means no limit.
+	 */
+	void set_weigher(size_t (*weigh_entry)(const Key &, const T &)) {
+	    weigher = weigh_entry;
+	    weight_total = 0;
+	    for (Node* current = head; current; current = current->next) {
+	        current->weight = weigh(current->data);
+	        weight_total += current->weight;
+	    }
+	    evict_over_weight(nullptr);
+	}
+
+	void set_max_weight(size_t max_weight) {
+	    weight_limit = max_weight;
+	    evict_over_weight(nullptr);
+	}
+
+	size_t max_weight() const {
+	    return weight_limit;
+	}
+
+	size_t total_weight() const {
+	    return weight_total;
+	}
+
+	/**
+	 * weigh the entry at pos again, evicting older entries if it grew.
+	 * return false if it no longer fits the budget on its own; it is then
+	 * erased, and pos is invalidated.
+	 */
+	bool reweigh(iterator pos) {
+	    if (!pos.node || pos.map != this) throw invalid_iterator();
+	    Node* node = pos.node;
+	    weight_total -= node->weight;
+	    node->weight = weigh(node->data);
+	    weight_total += node->weight;
+	    if (weight_limit && node->weight > weight_limit) {
+	        erase_node(node);
+	        return false;
+	    }
+	    evict_over_weight(node);
+	    return true;
+	}
+
+	/**
+	 * number of buckets, and the bucket that key maps to.
+	 * Bucket placement is seeded per instance and changes on rehash.
+	 */
+	size_t bucket_count() const {
+	    return table_size;
+	}
+
+	size_t bucket(const Key &key) const {
+	    return bucket_of(hash_func(key));
+	}
+
+	/**
+	 * the longest chain an insert has met so far. Once it passes
+	 * REKEY_THRESHOLD the map assumes a hash-flooding attack, switches to
+	 * keyed SipHash and rehashes once.
+	 */
+	size_t longest_chain() const {
+	    return chain_record;
+	}
+
+	/**
+	 * immutable snapshot with a minimal perfect hash, for maps that stop
+	 * changing after a load phase. Defined in frozen_linked_hashmap.hpp.
+	 */
+	frozen_linked_hashmap<Key, T, Hash, Equal> freeze() const;
+
+	/**
+	 * track the keys that dominate traffic, with at most capacity counters
+	 * (0 turns tracking off). find, at, operator[] and insert on a
+	 * non-const map each count one access of their key, present or not,
+	 * in O(1). Const lookups and count() are not tracked, so readers that
+	 * share a const map never write to it. Enabling again starts over;
+	 * copies get the setting but not the counts.
+	 */
+	void enable_hot_keys(size_t capacity) {
+	    delete hot;
+	    hot = capacity ? new HotKeys(capacity, equal_func) : nullptr;
+	}
+
+	/**
+	 * the k most accessed keys since tracking began, most accessed first,
+	 * each mapped to its approximate count. Counts never undercount, and
+	 * a key tracked all along is exact; keys tracked after an eviction
+	 * may overcount by as much as the least count tracked. Any key with
+	 * more than 1/capacity of all accesses is always present.
+	 * Empty if tracking is off.
+	 */
+	linked_hashmap<Key, size_t, Hash, Equal> hot_keys(size_t k) const {
+	    linked_hashmap<Key, size_t, Hash, Equal> top;
+	    if (!hot) return top;
+	    for (typename HotKeys::Group* group = hot->highest; group && k > 0; group = group->lower) {
+	        for (typename HotKeys::Counter* counter = group->first; counter && k > 0; counter = counter->next, --k) {
+	            top.insert(typename linked_hashmap<Key, size_t, Hash, Equal>::value_type(counter->key, group->count));
+	        }
+	    }
+	    return top;
+	}
+
+	/**
+	 * walks the elements in key order; only maps with an ordered index
+	 * hand these out. Inserting or erasing other elements leaves it valid.
+	 */
+	class ordered_iterator {
+	    friend class linked_hashmap;
+	    typename OrderedIndex::Rank* rank;
+
+	    ordered_iterator(typename OrderedIndex::Rank* r) : rank(r) {}
+
+	public:
+		ordered_iterator() : rank(nullptr) {}
+		ordered_iterator(const ordered_iterator &other) : rank(other.rank) {}
+
+		ordered_iterator operator++(int) {
+		    ordered_iterator temp = *this;
+		    ++*this;
+		    return temp;
+		}
+
+		ordered_iterator & operator++() {
+		    if (!rank) throw invalid_iterator();
+		    rank = rank->next[0];
+		    return *this;
+		}
+
+		value_type & operator*() const {
+		    if (!rank) throw invalid_iterator();
+		    return rank->node->data;
+		}
+
+		value_type* operator->() const noexcept {
+		    if (!rank) return nullptr;
+		    return &rank->node->data;
+		}
+
+		bool operator==(const ordered_iterator &rhs) const {
+		    return rank == rhs.rank;
+		}
+
+		bool operator!=(const ordered_iterator &rhs) const {
+		    return rank != rhs.rank;
+		}
+	};
+
+	class const_ordered_iterator {
+	    friend class linked_hashmap;
+	    const typename OrderedIndex::Rank* rank;
+
+	    const_ordered_iterator(const typename OrderedIndex::Rank* r) : rank(r) {}
+
+	public:
+		const_ordered_iterator() : rank(nullptr) {}
+		const_ordered_iterator(const const_ordered_iterator &other) : rank(other.rank) {}
+		const_ordered_iterator(const ordered_iterator &other) : rank(other.rank) {}
+
+		const_ordered_iterator operator++(int) {
+		    const_ordered_iterator temp = *this;
+		    ++*this;
+		    return temp;
+		}
+
+		const_ordered_iterator & operator++() {
+		    if (!rank) throw invalid_iterator();
+		    rank = rank->next[0];
+		    return *this;
+		}
+
+		const value_type & operator*() const {
+		    if (!rank) throw invalid_iterator();
+		    return rank->node->data;
+		}
+
+		const value_type* operator->() const noexcept {
+		    if (!rank) return nullptr;
+		    return &rank->node->data;
+		}
+
+		bool operator==(const const_ordered_iterator &rhs) const {
+		    return rank == rhs.rank;
+		}
+
+		bool operator!=(const const_ordered_iterator &rhs) const {
+		    return rank != rhs.rank;
+		}
+	};
+
+	/**
+	 * keep the elements in key order as well, for lower_bound, upper_bound
+	 * and ordered_begin(). less must be a strict weak order under which
+	 * keys are equivalent exactly when Equal says they are; the default
+	 * uses operator<. nullptr drops the index. Building it costs
+	 * O(n log n); afterwards every insert and erase pays O(log n) for it,
+	 * and hash lookups and insertion order are unaffected.
+	 */
+	void enable_ordered_index(bool (*less)(const Key &, const Key &) = key_less) {
+	    delete ordered;
+	    ordered = nullptr;
+	    if (!less) return;
+	    ordered = new OrderedIndex(less);
+	    for (Node* current = head; current; current = current->next) {
+	        ordered->insert(current);
+	    }
+	}
+
+	bool has_ordered_index() const {
+	    return ordered;
+	}
+
+	/**
+	 * the first element whose key is not below key, in key order.
+	 * throw runtime_error if there is no ordered index.
+	 */
+	ordered_iterator lower_bound(const Key &key) {
+	    if (!ordered) throw runtime_error();
+	    return ordered_iterator(ordered->lower_bound(key));
+	}
+
+	const_ordered_iterator lower_bound(const Key &key) const {
+	    if (!ordered) throw runtime_error();
+	    return const_ordered_iterator(ordered->lower_bound(key));
+	}
+
+	/**
+	 * the first element whose key is above key, in key order.
+	 * throw runtime_error if there is no ordered index.
+	 */
+	ordered_iterator upper_bound(const Key &key) {
+	    if (!ordered) throw runtime_error();
+	    return ordered_iterator(ordered->upper_bound(key));
+	}
+
+	const_ordered_iterator upper_bound(const Key &key) const {
+	    if (!ordered) throw runtime_error();
+	    return const_ordered_iterator(ordered->upper_bound(key));
+	}
+
+	/**
+	 * the smallest key and past the largest; [lower_bound(a),
+	 * upper_bound(b)) are the keys between a and b.
+	 * throw runtime_error if there is no ordered index.
+	 */
+	ordered_iterator ordered_begin() {
+	    if (!ordered) throw runtime_error();
+	    return ordered_iterator(ordered->heads[0]);
+	}
+
+	const_ordered_iterator ordered_begin() const {
+	    if (!ordered) throw runtime_error();
+	    return const_ordered_iterator(ordered->heads[0]);
+	}
+
+	ordered_iterator ordered_end() {
+	    return ordered_iterator();
+	}
+
+	const_ordered_iterator ordered_end() const {
+	    return const_ordered_iterator();
+	}
+
+	/**
+	 * move the element at pos to the end of the iteration order, as if it
+	 * had just been inserted; it also gets a fresh stamp. Together with
+	 * eviction from the head (set_max_weight) this makes the map an LRU
+	 * cache.
+	 * throw invalid_iterator if pos is end() or belongs to another map.
+	 */
+	void move_to_back(iterator pos) {
+	    if (!pos.node || pos.map != this) throw invalid_iterator();
+	    Node* node = pos.node;
+	    node->stamp = next_stamp();
+	    if (node == tail) return;
+	    remove_from_list(node);
+	    node->prev = tail;
+	    node->next = nullptr;
+	    tail->next = node;
+	    tail = node;
+	}
+
+	/**
+	 * arrival stamp of the element at pos. Stamps increase with every
+	 * insertion into any map of this type, and are kept by copies and merges.
+	 */
+	unsigned long long stamp(const_iterator pos) const {
+	    if (!pos.node || pos.map != this) throw invalid_iterator();
+	    return pos.node->stamp;
+	}
+
+	/**
+	 * move every element of sources[0..n) into this map, appending them in
+	 * global arrival order (k-way merge by stamp). Nodes are relinked, not
+	 * copied; the sources are left empty.
+	 * Elements already in this map count as having arrived first. When a key
+	 * is already present, policy(kept_value, incoming_value) is called and the
+	 * incoming node is dropped.
+	 */
+	template<class Policy>
+	void merge_ordered(linked_hashmap *const *sources, size_t n, Policy policy) {
+	    size_t incoming = 0;
+	    for (size_t i = 0; i < n; ++i) {
+	        if (sources[i] != this) incoming += sources[i]->element_count;
+	    }
+	    reserve_for(incoming);
+
+	    while (true) {
+	        // the number of sources is the number of producer threads, so a
+	        // linear scan for the oldest head beats maintaining a heap
+	        linked_hashmap* from = nullptr;
+	        for (size_t i = 0; i < n; ++i) {
+	            linked_hashmap* source = sources[i];
+	            if (source == this || !source->head) continue;
+	            if (!from || source->head->stamp < from->head->stamp) from = source;
+	        }
+	        if (!from) break;
+
+	        Node* node = from->head;
+	        // slab nodes cannot change owner; those move as heap copies, made
+	        // before unlinking so that a throwing copy leaves the source whole
+	        Node* moved = from->in_slab(node) ? new Node(*node) : node;
+	        from->remove_from_hash(node);
+	        from->remove_from_list(node);
+	        if (from->ordered) from->ordered->erase(node);
+	        if (moved != node) {
+	            from->free_node(node);
+	            node = moved;
+	        }
+	        from->element_count--;
+	        from->weight_total -= node->weight;
+	        if (from->filter) from->filter_stale++;
+
+	        Node* existing = find_node(node->data.first, node->hash);
+	        if (existing) {
+	            try {
+	                policy(existing->data.second, node->data.second);
+	            } catch (...) {
+	                delete node;
+	                throw;
+	            }
+	            weight_total -= existing->weight;
+	            existing->weight = weigh(existing->data);
+	            weight_total += existing->weight;
+	            delete node;
+	        } else {
+	            node->prev = node->next = nullptr;
+	            node->hash_prev = node->hash_next = nullptr;
+	            node->weight = weigh(node->data);
+	            link_node(node);
+	        }
+	    }
+	    // the drained sources hold only stale Bloom bits
+	    for (size_t i = 0; i < n; ++i) {
+	        if (sources[i] != this && sources[i]->filter) sources[i]->rebuild_filter();
+	    }
+	    evict_over_weight(nullptr);
+	}
+
+	template<class Policy, class... Maps>
+	void merge_ordered(Policy policy, linked_hashmap &first, Maps &... rest) {
+	    linked_hashmap* sources[] = {&first, &rest...};
+	    merge_ordered(sources, 1 + sizeof...(rest), policy);
+	}
 };
 
 }
@@ -0,0 +1,107 @@
+/**
+ * implement the iterator over the insertion-order list of a node-based map
+ */
+#ifndef SJTU_LIST_ITERATOR_HPP
+#define SJTU_LIST_ITERATOR_HPP
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include "exceptions.hpp"
+
+namespace sjtu {
+    /**
+     * list_iterator walks the doubly linked insertion-order list that
+     * cuckoo_linked_hashmap and adaptive_linked_hashmap keep beside their
+     * indexes. Node needs data, prev and next; Map needs head and tail and
+     * lets list_iterator read them.
+     *
+     * A map's iterator is list_iterator<Map, Node, value_type> and its
+     * const_iterator list_iterator<Map, const Node, const value_type>; the
+     * first converts to the second, and the two compare with each other.
+     * end() holds a null node, and -- on it goes to the tail. Stepping past
+     * either end, or moving an iterator of no map, throws invalid_iterator.
+     */
+
+template<
+	class Map,
+	class Node,
+	class Value
+> class list_iterator {
+public:
+	using difference_type = std::ptrdiff_t;
+	using value_type = typename std::remove_const<Value>::type;
+	using pointer = Value*;
+	using reference = Value&;
+	using iterator_category = std::bidirectional_iterator_tag;
+
+	Node* node;
+	const Map* map;
+
+	list_iterator() : node(nullptr), map(nullptr) {}
+	list_iterator(Node* n, const Map* m) : node(n), map(m) {}
+
+	/**
+	 * iterator to const_iterator; the other way round does not compile.
+	 */
+	template<class OtherNode, class OtherValue>
+	list_iterator(const list_iterator<Map, OtherNode, OtherValue> &other) : node(other.node), map(other.map) {}
+
+	list_iterator operator++(int) {
+	    list_iterator temp = *this;
+	    ++*this;
+	    return temp;
+	}
+
+	list_iterator & operator++() {
+	    if (!map || !node) throw invalid_iterator();
+	    node = node->next;
+	    return *this;
+	}
+
+	list_iterator operator--(int) {
+	    list_iterator temp = *this;
+	    --*this;
+	    return temp;
+	}
+
+	list_iterator & operator--() {
+	    if (!map) throw invalid_iterator();
+	    if (!node) {
+	        if (!map->tail) throw invalid_iterator();
+	        node = map->tail;
+	    } else if (node == map->head) {
+	        throw invalid_iterator();
+	    } else {
+	        node = node->prev;
+	    }
+	    return *this;
+	}
+
+	Value & operator*() const {
+	    if (!node) throw invalid_iterator();
+	    return node->data;
+	}
+
+	/**
+	 * for it->first; null on end().
+	 */
+	Value* operator->() const noexcept {
+	    if (!node) return nullptr;
+	    return &(node->data);
+	}
+
+	template<class OtherNode, class OtherValue>
+	bool operator==(const list_iterator<Map, OtherNode, OtherValue> &rhs) const {
+	    return node == rhs.node && map == rhs.map;
+	}
+
+	template<class OtherNode, class OtherValue>
+	bool operator!=(const list_iterator<Map, OtherNode, OtherValue> &rhs) const {
+	    return !(*this == rhs);
+	}
+};
+
+}
+
+#endif
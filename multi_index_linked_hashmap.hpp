@@ -0,0 +1,496 @@
+/**
+ * implement a linked_hashmap with secondary hash indexes on its values
+ */
+#ifndef SJTU_MULTI_INDEX_LINKEDHASHMAP_HPP
+#define SJTU_MULTI_INDEX_LINKEDHASHMAP_HPP
+
+#include <cstddef>
+#include <tuple>
+#include "linked_hashmap.hpp"
+
+namespace sjtu {
+    /**
+     * declares one secondary index: Extractor maps a value to a K, and
+     * entries are found by that K with Hash and Equal. Several entries may
+     * share a K.
+     *
+     *   struct city_of { std::string operator()(const Person &p) const { return p.city; } };
+     *   typedef hashed_index<std::string, city_of> by_city;
+     */
+    template<
+        class K,
+        class Extractor,
+        class Hash = std::hash<K>,
+        class Equal = std::equal_to<K>
+    > struct hashed_index {
+        typedef K key_type;
+        typedef Extractor extractor;
+        typedef Hash hasher;
+        typedef Equal key_equal;
+    };
+
+    /**
+     * multi_index_linked_hashmap is a linked_hashmap from Key to T that
+     * also finds entries by fields derived from their values, one
+     * hashed_index per field. The indexes do not keep nodes of their own:
+     * every entry carries, next to its value in the primary node, a chain
+     * link (next and pprev) and a cached hash per index, plus one iterator
+     * back to its primary element. An index thus costs a bucket array and
+     * three words per entry, and find_by<I>(k) is a single bucket probe;
+     * equal_range_by<I>(k) walks every entry sharing k.
+     *
+     * Indexes are kept in sync by insert, erase, clear and by assigning
+     * through the reference that at() and operator[] return; values are
+     * read-only otherwise, so a field cannot change behind an index.
+     * Extractors see the mapped value; the key is the primary index.
+     *
+     * Iteration follows insertion order, as in linked_hashmap; *it gives a
+     * pair of references (first, second) into the map.
+     */
+
+template<
+	class Key,
+	class T,
+	class Hash,
+	class Equal,
+	class... Indexes
+> class multi_index_linked_hashmap {
+private:
+    static const size_t INDEXES = sizeof...(Indexes);
+    // with no secondary index the link arrays still need a size
+    static const size_t LINKS = INDEXES ? INDEXES : 1;
+
+    template<size_t I>
+    using index_at = typename std::tuple_element<I, std::tuple<Indexes...>>::type;
+
+    struct Slot;
+    typedef linked_hashmap<Key, Slot, Hash, Equal> Primary;
+
+    // the mapped value plus its place on every secondary chain
+    struct Slot {
+        T value;
+        // the primary element holding this slot, for find_by and erase
+        typename Primary::iterator self;
+        Slot* next[LINKS];
+        Slot** pprev[LINKS];
+        size_t hash[LINKS];
+
+        Slot(const T& v) : value(v), self(), next(), pprev(), hash() {}
+        Slot(const Slot& other) : value(other.value), self(), next(), pprev(), hash() {}
+    };
+
+    struct Table {
+        Slot** buckets;
+        size_t bits;
+        size_t count;
+    };
+
+    static const size_t INITIAL_BITS = 4;
+
+    Primary primary;
+    Table tables[LINKS];
+
+    static size_t bucket_of(size_t h, size_t bits) {
+        // Fibonacci hashing: the top bits of h * 2^64 / phi
+        return (unsigned long long)h * 0x9E3779B97F4A7C15ULL >> (64 - bits);
+    }
+
+    template<size_t I>
+    static size_t hash_of(const T& value) {
+        return typename index_at<I>::hasher()(typename index_at<I>::extractor()(value));
+    }
+
+    void create_tables() {
+        for (size_t i = 0; i < INDEXES; ++i) {
+            tables[i].bits = INITIAL_BITS;
+            tables[i].count = 0;
+            tables[i].buckets = new Slot*[size_t(1) << INITIAL_BITS]();
+        }
+    }
+
+    void destroy_tables() {
+        for (size_t i = 0; i < INDEXES; ++i) delete[] tables[i].buckets;
+    }
+
+    void push(size_t i, Slot* slot) {
+        Slot** head = &tables[i].buckets[bucket_of(slot->hash[i], tables[i].bits)];
+        slot->next[i] = *head;
+        slot->pprev[i] = head;
+        if (*head) (*head)->pprev[i] = &slot->next[i];
+        *head = slot;
+    }
+
+    void grow(size_t i) {
+        Table& table = tables[i];
+        Slot** old = table.buckets;
+        size_t old_size = size_t(1) << table.bits;
+        table.bits++;
+        table.buckets = new Slot*[size_t(1) << table.bits]();
+        for (size_t b = 0; b < old_size; ++b) {
+            Slot* slot = old[b];
+            while (slot) {
+                Slot* next = slot->next[i];
+                push(i, slot);
+                slot = next;
+            }
+        }
+        delete[] old;
+    }
+
+    template<size_t I = 0>
+    void link(Slot* slot) {
+        if constexpr (I < INDEXES) {
+            slot->hash[I] = hash_of<I>(slot->value);
+            if (++tables[I].count > (size_t(1) << tables[I].bits)) grow(I);
+            push(I, slot);
+            link<I + 1>(slot);
+        }
+    }
+
+    void unlink(Slot* slot) {
+        for (size_t i = 0; i < INDEXES; ++i) {
+            *slot->pprev[i] = slot->next[i];
+            if (slot->next[i]) slot->next[i]->pprev[i] = slot->pprev[i];
+            tables[i].count--;
+        }
+    }
+
+    template<size_t I>
+    Slot* probe(const typename index_at<I>::key_type& key) const {
+        size_t h = typename index_at<I>::hasher()(key);
+        typename index_at<I>::key_equal equal;
+        typename index_at<I>::extractor extract;
+        Slot* slot = tables[I].buckets[bucket_of(h, tables[I].bits)];
+        while (slot && !(slot->hash[I] == h && equal(extract(slot->value), key))) slot = slot->next[I];
+        return slot;
+    }
+
+    void assign(Slot& slot, const T& value) {
+        unlink(&slot);
+        try {
+            slot.value = value;
+        } catch (...) {
+            link(&slot);
+            throw;
+        }
+        link(&slot);
+    }
+
+    void copy_from(const multi_index_linked_hashmap& other) {
+        for (typename Primary::const_iterator it = other.primary.cbegin(); it != other.primary.cend(); ++it) {
+            insert(pair<const Key, T>(it->first, it->second.value));
+        }
+    }
+
+public:
+	/**
+	 * what operator[] and at() return: reads see the stored value, and
+	 * assignment re-indexes it. Valid until the entry is erased.
+	 */
+	class reference {
+	    friend class multi_index_linked_hashmap;
+	    multi_index_linked_hashmap* map;
+	    Slot* slot;
+
+	    reference(multi_index_linked_hashmap* m, Slot* s) : map(m), slot(s) {}
+
+	public:
+		operator const T &() const {
+		    return slot->value;
+		}
+
+		const T & get() const {
+		    return slot->value;
+		}
+
+		reference & operator=(const T &value) {
+		    map->assign(*slot, value);
+		    return *this;
+		}
+
+		reference & operator=(const reference &other) {
+		    return *this = other.get();
+		}
+	};
+
+	struct entry {
+		const Key &first;
+		const T &second;
+	};
+
+	class const_iterator {
+	    friend class multi_index_linked_hashmap;
+	    typename Primary::const_iterator it;
+
+	    const_iterator(typename Primary::const_iterator i) : it(i) {}
+
+	public:
+		// for it->first; holds the pair that operator* builds
+		struct arrow {
+			entry value;
+			const entry* operator->() const {
+			    return &value;
+			}
+		};
+
+		const_iterator() {}
+		const_iterator(const const_iterator &other) : it(other.it) {}
+
+		const_iterator operator++(int) {
+		    const_iterator temp = *this;
+		    ++it;
+		    return temp;
+		}
+
+		const_iterator & operator++() {
+		    ++it;
+		    return *this;
+		}
+
+		const_iterator operator--(int) {
+		    const_iterator temp = *this;
+		    --it;
+		    return temp;
+		}
+
+		const_iterator & operator--() {
+		    --it;
+		    return *this;
+		}
+
+		entry operator*() const {
+		    return entry{(*it).first, (*it).second.value};
+		}
+
+		arrow operator->() const {
+		    return arrow{**this};
+		}
+
+		bool operator==(const const_iterator &rhs) const {
+		    return it == rhs.it;
+		}
+
+		bool operator!=(const const_iterator &rhs) const {
+		    return it != rhs.it;
+		}
+	};
+
+	multi_index_linked_hashmap() {
+	    create_tables();
+	}
+
+	multi_index_linked_hashmap(const multi_index_linked_hashmap &other) {
+	    create_tables();
+	    copy_from(other);
+	}
+
+	multi_index_linked_hashmap & operator=(const multi_index_linked_hashmap &other) {
+	    if (this == &other) return *this;
+	    clear();
+	    copy_from(other);
+	    return *this;
+	}
+
+	~multi_index_linked_hashmap() {
+	    destroy_tables();
+	}
+
+	/**
+	 * access specified element with bounds checking
+	 * throw index_out_of_bound if such key does not exist.
+	 */
+	reference at(const Key &key) {
+	    return reference(this, &primary.at(key));
+	}
+
+	const T & at(const Key &key) const {
+	    return primary.at(key).value;
+	}
+
+	/**
+	 * access specified element, inserting a default value if such key
+	 * does not exist.
+	 */
+	reference operator[](const Key &key) {
+	    typename Primary::iterator it = primary.find(key);
+	    if (it == primary.end()) {
+	        return reference(this, &insert_slot(pair<const Key, T>(key, T())).first->second);
+	    }
+	    return reference(this, &it->second);
+	}
+
+	const T & operator[](const Key &key) const {
+	    return at(key);
+	}
+
+	const_iterator cbegin() const {
+	    return const_iterator(primary.cbegin());
+	}
+
+	const_iterator cend() const {
+	    return const_iterator(primary.cend());
+	}
+
+	const_iterator begin() const {
+	    return cbegin();
+	}
+
+	const_iterator end() const {
+	    return cend();
+	}
+
+	bool empty() const {
+	    return primary.empty();
+	}
+
+	size_t size() const {
+	    return primary.size();
+	}
+
+	void clear() {
+	    primary.clear();
+	    destroy_tables();
+	    create_tables();
+	}
+
+	/**
+	 * insert an element.
+	 * return a pair, the first of the pair is
+	 *   the iterator to the new element (or the element that prevented the insertion),
+	 *   the second one is true if insert successfully, or false.
+	 */
+	pair<const_iterator, bool> insert(const pair<const Key, T> &value) {
+	    pair<typename Primary::iterator, bool> placed = insert_slot(value);
+	    return pair<const_iterator, bool>(const_iterator(typename Primary::const_iterator(placed.first)), placed.second);
+	}
+
+	/**
+	 * erase the element at pos.
+	 * throw invalid_iterator if pos is end() or points to another map.
+	 */
+	void erase(const_iterator pos) {
+	    if (pos.it.map != &primary || pos == cend()) throw invalid_iterator();
+	    typename Primary::iterator it = pos.it->second.self;
+	    unlink(&it->second);
+	    primary.erase(it);
+	}
+
+	size_t count(const Key &key) const {
+	    return primary.count(key);
+	}
+
+	const_iterator find(const Key &key) const {
+	    return const_iterator(primary.find(key));
+	}
+
+	/**
+	 * an element whose field for index I equals key, or end(). With
+	 * several, the one indexed most recently.
+	 */
+	template<size_t I>
+	const_iterator find_by(const typename index_at<I>::key_type &key) const {
+	    static_assert(I < INDEXES, "no such index");
+	    Slot* slot = probe<I>(key);
+	    if (!slot) return cend();
+	    return const_iterator(slot->self);
+	}
+
+	/**
+	 * walks the elements whose field for index I equals one key, most
+	 * recently indexed first; converts to the const_iterator of the
+	 * element it is at. Erasing or re-indexing an element the walk has
+	 * not passed yet invalidates it.
+	 */
+	template<size_t I>
+	class index_iterator {
+	    friend class multi_index_linked_hashmap;
+	    typedef typename index_at<I>::key_type key_type;
+
+	    Slot* slot;
+	    key_type key;
+	    size_t hash;
+
+	    index_iterator(Slot* s, const key_type& k, size_t h) : slot(s), key(k), hash(h) {}
+
+	public:
+		index_iterator & operator++() {
+		    if (!slot) throw invalid_iterator();
+		    typename index_at<I>::key_equal equal;
+		    typename index_at<I>::extractor extract;
+		    do {
+		        slot = slot->next[I];
+		    } while (slot && !(slot->hash[I] == hash && equal(extract(slot->value), key)));
+		    return *this;
+		}
+
+		index_iterator operator++(int) {
+		    index_iterator temp = *this;
+		    ++*this;
+		    return temp;
+		}
+
+		entry operator*() const {
+		    if (!slot) throw invalid_iterator();
+		    return entry{slot->self->first, slot->value};
+		}
+
+		typename const_iterator::arrow operator->() const {
+		    return typename const_iterator::arrow{**this};
+		}
+
+		operator const_iterator() const {
+		    if (!slot) throw invalid_iterator();
+		    return const_iterator(slot->self);
+		}
+
+		bool operator==(const index_iterator &rhs) const {
+		    return slot == rhs.slot;
+		}
+
+		bool operator!=(const index_iterator &rhs) const {
+		    return slot != rhs.slot;
+		}
+	};
+
+	/**
+	 * every element whose field for index I equals key, as [first, second).
+	 */
+	template<size_t I>
+	pair<index_iterator<I>, index_iterator<I>> equal_range_by(const typename index_at<I>::key_type &key) const {
+	    static_assert(I < INDEXES, "no such index");
+	    size_t h = typename index_at<I>::hasher()(key);
+	    return pair<index_iterator<I>, index_iterator<I>>(index_iterator<I>(probe<I>(key), key, h),
+	                                                      index_iterator<I>(nullptr, key, h));
+	}
+
+	/**
+	 * the number of elements whose field for index I equals key.
+	 */
+	template<size_t I>
+	size_t count_by(const typename index_at<I>::key_type &key) const {
+	    static_assert(I < INDEXES, "no such index");
+	    size_t h = typename index_at<I>::hasher()(key);
+	    typename index_at<I>::key_equal equal;
+	    typename index_at<I>::extractor extract;
+	    size_t total = 0;
+	    for (Slot* slot = probe<I>(key); slot; slot = slot->next[I]) {
+	        total += slot->hash[I] == h && equal(extract(slot->value), key);
+	    }
+	    return total;
+	}
+
+private:
+    pair<typename Primary::iterator, bool> insert_slot(const pair<const Key, T> &value) {
+        pair<typename Primary::iterator, bool> placed =
+            primary.insert(typename Primary::value_type(value.first, Slot(value.second)));
+        if (placed.second) {
+            placed.first->second.self = placed.first;
+            link(&placed.first->second);
+        }
+        return placed;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,113 @@
+/**
+ * allocation cost of each linked_hashmap operation, measured with the
+ * counting operator new from alloc_shim.cpp.
+ *
+ *   linked_hashmap_alloc_profile [elements]
+ *
+ * find, count and iteration must not allocate; the program says which
+ * did and exits with status 1 if any did.
+ */
+#include "linked_hashmap.hpp"
+#include "alloc_shim.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+static std::string make_key(size_t i, std::string *) {
+    return "key:" + std::to_string(i * 2654435761u);
+}
+
+static long long make_key(size_t i, long long *) {
+    return (long long)(i * 2654435761u);
+}
+
+static alloc_shim::counters mark;
+
+static void start() {
+    mark = alloc_shim::snapshot();
+}
+
+// allocations, frees and bytes since start(), per operation
+static void report(const char *label, const char *operation, size_t operations) {
+    alloc_shim::counters now = alloc_shim::snapshot();
+    double n = operations ? double(operations) : 1;
+    std::printf("%-10s %-10s %12.3f %12.3f %14.1f\n", label, operation,
+                (now.allocations - mark.allocations) / n, (now.deallocations - mark.deallocations) / n,
+                (now.bytes - mark.bytes) / n);
+}
+
+// run f with allocation forbidden; returns how many happened anyway
+template<class F>
+static unsigned long long must_not_allocate(const char *label, const char *operation, F f) {
+    unsigned long long before = alloc_shim::snapshot().forbidden;
+    alloc_shim::forbid(true);
+    f();
+    alloc_shim::forbid(false);
+    unsigned long long made = alloc_shim::snapshot().forbidden - before;
+    std::printf("%-10s %-10s %12s %12s %14s%s\n", label, operation, "-", "-", "-",
+                made ? "   ALLOCATES" : "");
+    return made;
+}
+
+template<class Key>
+static unsigned long long profile(const char *label, size_t elements) {
+    typedef sjtu::linked_hashmap<Key, long long> Map;
+    std::vector<Key> keys;
+    keys.reserve(2 * elements);
+    for (size_t i = 0; i < 2 * elements; ++i) keys.push_back(make_key(i, (Key *)nullptr));
+    unsigned long long violations = 0;
+
+    alloc_shim::reset_peak();
+    unsigned long long base = alloc_shim::snapshot().live_bytes;
+    Map *map = new Map;
+    start();
+    for (size_t i = 0; i < elements; ++i) map->insert(typename Map::value_type(keys[i], i));
+    report(label, "insert", elements);
+    unsigned long long peak = alloc_shim::snapshot().peak_live_bytes - base;
+
+    size_t found = 0;
+    violations += must_not_allocate(label, "find", [&] {
+        // hits and misses
+        for (size_t i = 0; i < 2 * elements; ++i) found += map->find(keys[i]) != map->end();
+    });
+    violations += must_not_allocate(label, "count", [&] {
+        for (size_t i = 0; i < 2 * elements; ++i) found += map->count(keys[i]);
+    });
+    violations += must_not_allocate(label, "iterate", [&] {
+        for (typename Map::const_iterator it = map->cbegin(); it != map->cend(); ++it) found += it->second & 1;
+    });
+
+    start();
+    Map *copy = new Map(*map);
+    report(label, "copy", elements);
+
+    start();
+    for (size_t i = 0; i < elements; i += 2) map->erase(map->find(keys[i]));
+    report(label, "erase", (elements + 1) / 2);
+
+    start();
+    map->clear();
+    report(label, "clear", elements - (elements + 1) / 2);
+
+    double fragmentation = alloc_shim::fragmentation();
+    delete copy;
+    delete map;
+    std::printf("%-10s peak live %.1f bytes/element, fragmentation after clear %.3f\n", label,
+                double(peak) / elements, fragmentation);
+    if (!found) std::printf("(nothing found)\n");
+    return violations;
+}
+
+int main(int argc, char *argv[]) {
+    size_t elements = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    if (!elements) elements = 1;
+    std::printf("%-10s %-10s %12s %12s %14s\n", "key", "operation", "allocs/op", "frees/op", "bytes/op");
+    unsigned long long violations = profile<long long>("integer", elements);
+    violations += profile<std::string>("string", elements);
+    if (violations) {
+        std::printf("%llu allocations on allocation-free paths\n", violations);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+/**
+ * see alloc_shim.hpp
+ */
+#include "alloc_shim.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <malloc.h>
+
+namespace {
+    alloc_shim::counters totals;
+    bool forbidding = false;
+    int abort_on_forbidden = -1;
+
+    void record_allocation(void* pointer) {
+        unsigned long long size = malloc_usable_size(pointer);
+        __atomic_add_fetch(&totals.allocations, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&totals.bytes, size, __ATOMIC_RELAXED);
+        unsigned long long live = __atomic_add_fetch(&totals.live_bytes, size, __ATOMIC_RELAXED);
+        unsigned long long peak = __atomic_load_n(&totals.peak_live_bytes, __ATOMIC_RELAXED);
+        while (live > peak && !__atomic_compare_exchange_n(&totals.peak_live_bytes, &peak, live, true,
+                                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+        if (__atomic_load_n(&forbidding, __ATOMIC_RELAXED)) {
+            __atomic_add_fetch(&totals.forbidden, 1, __ATOMIC_RELAXED);
+            if (abort_on_forbidden < 0) {
+                const char* flag = std::getenv("ALLOC_SHIM_ABORT");
+                abort_on_forbidden = flag && flag[0] == '1';
+            }
+            if (abort_on_forbidden) std::abort();
+        }
+    }
+
+    void* allocate(std::size_t size) {
+        void* pointer = std::malloc(size ? size : 1);
+        if (!pointer) throw std::bad_alloc();
+        record_allocation(pointer);
+        return pointer;
+    }
+
+    void* allocate_aligned(std::size_t size, std::size_t alignment) {
+        void* pointer = nullptr;
+        if (alignment < sizeof(void*)) alignment = sizeof(void*);
+        if (posix_memalign(&pointer, alignment, size ? size : 1) != 0) throw std::bad_alloc();
+        record_allocation(pointer);
+        return pointer;
+    }
+
+    void release(void* pointer) {
+        if (!pointer) return;
+        __atomic_add_fetch(&totals.deallocations, 1, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(&totals.live_bytes, malloc_usable_size(pointer), __ATOMIC_RELAXED);
+        std::free(pointer);
+    }
+
+    struct reporter {
+        ~reporter() {
+            alloc_shim::counters c = alloc_shim::snapshot();
+            std::fprintf(stderr, "alloc_shim: %llu allocations, %llu frees, %llu bytes, peak live %llu bytes, "
+                                 "live at exit %llu bytes, fragmentation %.3f\n",
+                         c.allocations, c.deallocations, c.bytes, c.peak_live_bytes, c.live_bytes,
+                         alloc_shim::fragmentation());
+            if (c.forbidden) {
+                std::fprintf(stderr, "alloc_shim: %llu allocations on allocation-free paths\n", c.forbidden);
+            }
+        }
+    } report_at_exit;
+}
+
+namespace alloc_shim {
+    counters snapshot() {
+        counters c;
+        c.allocations = __atomic_load_n(&totals.allocations, __ATOMIC_RELAXED);
+        c.deallocations = __atomic_load_n(&totals.deallocations, __ATOMIC_RELAXED);
+        c.bytes = __atomic_load_n(&totals.bytes, __ATOMIC_RELAXED);
+        c.live_bytes = __atomic_load_n(&totals.live_bytes, __ATOMIC_RELAXED);
+        c.peak_live_bytes = __atomic_load_n(&totals.peak_live_bytes, __ATOMIC_RELAXED);
+        c.forbidden = __atomic_load_n(&totals.forbidden, __ATOMIC_RELAXED);
+        return c;
+    }
+
+    void reset_peak() {
+        __atomic_store_n(&totals.peak_live_bytes, __atomic_load_n(&totals.live_bytes, __ATOMIC_RELAXED),
+                         __ATOMIC_RELAXED);
+    }
+
+    void forbid(bool on) {
+        __atomic_store_n(&forbidding, on, __ATOMIC_RELAXED);
+    }
+
+    double fragmentation() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+        struct mallinfo2 info = mallinfo2();
+        double held = double(info.arena) + double(info.hblkhd);
+        if (held <= 0) return 0;
+        double live = double(__atomic_load_n(&totals.live_bytes, __ATOMIC_RELAXED));
+        return live >= held ? 0 : 1 - live / held;
+#else
+        return -1;
+#endif
+    }
+}
+
+void* operator new(std::size_t size) {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return allocate_aligned(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return allocate_aligned(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* pointer) noexcept {
+    release(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    release(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    release(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+    release(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    release(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+    release(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept {
+    release(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept {
+    release(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t &) noexcept {
+    release(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t &) noexcept {
+    release(pointer);
+}
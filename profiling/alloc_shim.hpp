@@ -0,0 +1,47 @@
+/**
+ * counting replacement for the global operator new and delete.
+ *
+ * Link alloc_shim.cpp into a program and every allocation through new is
+ * counted; a summary is written to stderr when the program exits, so the
+ * program's own output is unchanged. Programs that want finer numbers
+ * take snapshots around the code they measure.
+ */
+#ifndef SJTU_ALLOC_SHIM_HPP
+#define SJTU_ALLOC_SHIM_HPP
+
+#include <cstddef>
+
+namespace alloc_shim {
+    struct counters {
+        unsigned long long allocations;
+        unsigned long long deallocations;
+        // usable bytes handed out, as malloc_usable_size reports them
+        unsigned long long bytes;
+        unsigned long long live_bytes;
+        unsigned long long peak_live_bytes;
+        // allocations made while forbid() was on
+        unsigned long long forbidden;
+    };
+
+    counters snapshot();
+
+    /**
+     * restart peak_live_bytes from the current live bytes.
+     */
+    void reset_peak();
+
+    /**
+     * while on, every allocation also counts as forbidden. Meant to wrap
+     * code that should not allocate; set ALLOC_SHIM_ABORT=1 in the
+     * environment to abort at the first one, for a stack trace.
+     */
+    void forbid(bool on);
+
+    /**
+     * share of the heap held from the system that is not live data,
+     * between 0 and 1, or -1 where the allocator cannot tell.
+     */
+    double fragmentation();
+}
+
+#endif
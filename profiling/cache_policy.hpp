@@ -0,0 +1,234 @@
+/**
+ * cache eviction policies built on linked_hashmap, for simulating hit
+ * ratios over key-access traces (see linked_hashmap_cache_sim).
+ *
+ * Each cache holds at most a fixed number of keys and answers access(key)
+ * with whether it was a hit, admitting the key on a miss. The order list
+ * of the map is the policy's queue: its head is the next victim, and
+ * eviction from the head is the map's own weighted capacity with every
+ * entry weighing 1.
+ *
+ * lru_stack computes LRU for every capacity at once instead (Mattson's
+ * stack distances): LRU is a stack algorithm, so an access hits in a
+ * cache of capacity c exactly when fewer than c distinct keys were
+ * touched since the key's previous access.
+ */
+#ifndef SJTU_CACHE_POLICY_HPP
+#define SJTU_CACHE_POLICY_HPP
+
+#include <cstddef>
+#include <vector>
+#include "linked_hashmap.hpp"
+
+namespace sjtu {
+namespace cache {
+    typedef unsigned long long key_type;
+
+    template<class T>
+    size_t unit_weight(const key_type &, const T &) {
+        return 1;
+    }
+
+    /**
+     * first in, first out: hits do not reorder.
+     */
+    class fifo_cache {
+        linked_hashmap<key_type, char> entries;
+        // a weight limit of 0 would mean unlimited
+        size_t capacity;
+
+    public:
+        explicit fifo_cache(size_t size) : capacity(size) {
+            entries.set_weigher(unit_weight<char>);
+            entries.set_max_weight(size);
+        }
+
+        bool access(key_type key) {
+            if (entries.count(key)) return true;
+            if (!capacity) return false;
+            entries.insert(linked_hashmap<key_type, char>::value_type(key, 0));
+            return false;
+        }
+    };
+
+    /**
+     * least recently used: a hit moves the key to the back.
+     */
+    class lru_cache {
+        linked_hashmap<key_type, char> entries;
+        // a weight limit of 0 would mean unlimited
+        size_t capacity;
+
+    public:
+        explicit lru_cache(size_t size) : capacity(size) {
+            entries.set_weigher(unit_weight<char>);
+            entries.set_max_weight(size);
+        }
+
+        bool access(key_type key) {
+            linked_hashmap<key_type, char>::iterator it = entries.find(key);
+            if (it != entries.end()) {
+                entries.move_to_back(it);
+                return true;
+            }
+            if (!capacity) return false;
+            entries.insert(linked_hashmap<key_type, char>::value_type(key, 0));
+            return false;
+        }
+    };
+
+    /**
+     * CLOCK (second chance): a hit sets the key's reference bit; the hand
+     * is the head, which passes a referenced key to the back with its bit
+     * cleared instead of evicting it.
+     */
+    class clock_cache {
+        linked_hashmap<key_type, bool> entries;
+        size_t capacity;
+
+    public:
+        explicit clock_cache(size_t size) : capacity(size) {}
+
+        bool access(key_type key) {
+            linked_hashmap<key_type, bool>::iterator it = entries.find(key);
+            if (it != entries.end()) {
+                it->second = true;
+                return true;
+            }
+            if (!capacity) return false;
+            while (entries.size() >= capacity) {
+                linked_hashmap<key_type, bool>::iterator hand = entries.begin();
+                if (hand->second) {
+                    hand->second = false;
+                    entries.move_to_back(hand);
+                } else {
+                    entries.erase(hand);
+                }
+            }
+            entries[key] = false;
+            return false;
+        }
+    };
+
+    /**
+     * segmented LRU: new keys enter a probationary LRU segment, and a hit
+     * there promotes the key to a protected segment of PROTECTED_SHARE of
+     * the capacity, whose overflow is demoted back to probation. Keys
+     * seen once can thus never push out keys seen twice.
+     */
+    class slru_cache {
+        linked_hashmap<key_type, char> probation;
+        linked_hashmap<key_type, char> protect;
+        size_t capacity;
+        size_t protected_capacity;
+
+        static void push(linked_hashmap<key_type, char> &segment, key_type key) {
+            segment.insert(linked_hashmap<key_type, char>::value_type(key, 0));
+        }
+
+    public:
+        static constexpr double PROTECTED_SHARE = 0.8;
+
+        explicit slru_cache(size_t size) : capacity(size), protected_capacity(size_t(size * PROTECTED_SHARE)) {}
+
+        bool access(key_type key) {
+            linked_hashmap<key_type, char>::iterator it = protect.find(key);
+            if (it != protect.end()) {
+                protect.move_to_back(it);
+                return true;
+            }
+            linked_hashmap<key_type, char>::iterator trial = probation.find(key);
+            if (trial != probation.end()) {
+                probation.erase(trial);
+                push(protect, key);
+                if (protect.size() > protected_capacity) {
+                    linked_hashmap<key_type, char>::iterator demoted = protect.begin();
+                    push(probation, demoted->first);
+                    protect.erase(demoted);
+                }
+                return true;
+            }
+            if (!capacity) return false;
+            if (probation.size() + protect.size() >= capacity) {
+                if (!probation.empty()) {
+                    probation.erase(probation.begin());
+                } else {
+                    protect.erase(protect.begin());
+                }
+            }
+            push(probation, key);
+            return false;
+        }
+    };
+
+    /**
+     * LRU hit counts for all capacities in one pass over a trace of at
+     * most `accesses` keys. A Fenwick tree over access times marks the
+     * latest access of every key, so each stack distance is one range
+     * count, O(log accesses).
+     */
+    class lru_stack {
+        linked_hashmap<key_type, size_t> last_access;
+        std::vector<long> marks;
+        // distances[d]: repeat accesses at stack distance d (1 = same key again)
+        std::vector<size_t> distances;
+        size_t now;
+
+        void mark(size_t time, long delta) {
+            for (size_t i = time; i < marks.size(); i += i & -i) marks[i] += delta;
+        }
+
+        size_t marked_up_to(size_t time) const {
+            long total = 0;
+            for (size_t i = time; i > 0; i -= i & -i) total += marks[i];
+            return size_t(total);
+        }
+
+    public:
+        explicit lru_stack(size_t accesses) : marks(accesses + 1, 0), distances(1, 0), now(0) {}
+
+        /**
+         * record an access; returns its stack distance, or 0 for the first
+         * access of a key (a miss at every capacity).
+         * throw runtime_error past the number of accesses given.
+         */
+        size_t access(key_type key) {
+            if (now + 1 >= marks.size()) throw runtime_error();
+            size_t time = ++now;
+            size_t distance = 0;
+            linked_hashmap<key_type, size_t>::iterator it = last_access.find(key);
+            if (it != last_access.end()) {
+                size_t previous = it->second;
+                distance = marked_up_to(time - 1) - marked_up_to(previous) + 1;
+                mark(previous, -1);
+                it->second = time;
+                if (distance >= distances.size()) distances.resize(distance + 1, 0);
+                distances[distance]++;
+            } else {
+                last_access[key] = time;
+            }
+            mark(time, 1);
+            return distance;
+        }
+
+        /**
+         * hits an LRU cache of this capacity would have had.
+         */
+        size_t hits(size_t capacity) const {
+            size_t total = 0;
+            for (size_t d = 1; d < distances.size() && d <= capacity; ++d) total += distances[d];
+            return total;
+        }
+
+        size_t accesses() const {
+            return now;
+        }
+
+        size_t distinct_keys() const {
+            return last_access.size();
+        }
+    };
+}
+}
+
+#endif
@@ -0,0 +1,82 @@
+/**
+ * hit ratios of cache eviction policies over a recorded trace (see
+ * trace_recorder.hpp), for deciding on a policy before switching to it.
+ *
+ *   linked_hashmap_cache_sim <trace> [capacity ...]
+ *
+ * Every lookup or update in the trace counts as an access to its key;
+ * erase and clear records are skipped. Without capacities, powers of two
+ * up to the number of distinct keys are used. LRU comes from stack
+ * distances, exact for every capacity; FIFO, CLOCK and SLRU are simulated,
+ * all capacities side by side in one pass over the trace.
+ */
+#include "cache_policy.hpp"
+#include "trace_format.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <trace> [capacity ...]\n", argv[0]);
+        return 1;
+    }
+    std::FILE *in = std::fopen(argv[1], "rb");
+    if (!in || !sjtu::trace::read_magic(in)) {
+        std::fprintf(stderr, "%s: not a trace\n", argv[1]);
+        return 1;
+    }
+    std::vector<sjtu::cache::key_type> keys;
+    int op;
+    unsigned long long hash;
+    while (sjtu::trace::decode(in, op, hash)) {
+        if (op != sjtu::trace::op_erase && op != sjtu::trace::op_clear) keys.push_back(hash);
+    }
+    if (!std::feof(in)) {
+        std::fprintf(stderr, "%s: malformed record after %zu accesses; using those\n", argv[1], keys.size());
+    }
+    std::fclose(in);
+    if (keys.empty()) {
+        std::fprintf(stderr, "%s: no accesses\n", argv[1]);
+        return 1;
+    }
+
+    sjtu::cache::lru_stack lru(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) lru.access(keys[i]);
+
+    std::vector<size_t> capacities;
+    for (int i = 2; i < argc; ++i) capacities.push_back(std::strtoull(argv[i], nullptr, 10));
+    if (capacities.empty()) {
+        for (size_t c = 1; c < lru.distinct_keys(); c *= 2) capacities.push_back(c);
+        capacities.push_back(lru.distinct_keys());
+    }
+
+    std::vector<sjtu::cache::fifo_cache *> fifo;
+    std::vector<sjtu::cache::clock_cache *> clock;
+    std::vector<sjtu::cache::slru_cache *> slru;
+    for (size_t c : capacities) {
+        fifo.push_back(new sjtu::cache::fifo_cache(c));
+        clock.push_back(new sjtu::cache::clock_cache(c));
+        slru.push_back(new sjtu::cache::slru_cache(c));
+    }
+    std::vector<size_t> fifo_hits(capacities.size()), clock_hits(capacities.size()), slru_hits(capacities.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        for (size_t c = 0; c < capacities.size(); ++c) {
+            fifo_hits[c] += fifo[c]->access(keys[i]);
+            clock_hits[c] += clock[c]->access(keys[i]);
+            slru_hits[c] += slru[c]->access(keys[i]);
+        }
+    }
+
+    std::printf("%zu accesses, %zu distinct keys\n", keys.size(), lru.distinct_keys());
+    std::printf("%12s %8s %8s %8s %8s\n", "capacity", "fifo", "lru", "clock", "slru");
+    double total = double(keys.size());
+    for (size_t c = 0; c < capacities.size(); ++c) {
+        std::printf("%12zu %8.4f %8.4f %8.4f %8.4f\n", capacities[c], fifo_hits[c] / total,
+                    lru.hits(capacities[c]) / total, clock_hits[c] / total, slru_hits[c] / total);
+        delete fifo[c];
+        delete clock[c];
+        delete slru[c];
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+/**
+ * hash quality reports (see hash_quality.hpp) for common key shapes.
+ *
+ *   linked_hashmap_hash_quality [trace] [keys]
+ *
+ * Without a trace it analyzes the data/ tests' Hash, std::hash<int>
+ * truncated to unsigned int, over sequential, strided and random int keys,
+ * std::hash<std::string> over numbered strings, and fmix_hash of the
+ * tests' Hash for comparison. With a trace (see trace_recorder.hpp) it
+ * analyzes the recorded hashes as they would be bucketed, since a trace
+ * keeps hashes rather than keys.
+ */
+#include "hash_quality.hpp"
+#include "trace_format.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+// the data/ tests' Hash
+struct TruncatedHash {
+    unsigned int operator()(int key) const {
+        return std::hash<int>()(key);
+    }
+};
+
+// a recorded hash; not integral, so no avalanche is measured for the
+// identity that maps it back
+struct Recorded {
+    unsigned long long hash;
+};
+
+struct RecordedHash {
+    size_t operator()(const Recorded &recorded) const {
+        return recorded.hash;
+    }
+};
+
+template<class Key, class Hash>
+static void analyze(const char *label, const std::vector<Key> &keys) {
+    std::printf("== %s\n", label);
+    sjtu::print_report(sjtu::analyze_hash(keys.data(), keys.size(), Hash()), stdout);
+    std::printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && std::strtoull(argv[1], nullptr, 10) == 0) {
+        std::FILE *in = std::fopen(argv[1], "rb");
+        if (!in || !sjtu::trace::read_magic(in)) {
+            std::fprintf(stderr, "%s: not a trace\n", argv[1]);
+            return 1;
+        }
+        std::vector<unsigned long long> hashes;
+        int op;
+        unsigned long long hash;
+        while (sjtu::trace::decode(in, op, hash)) {
+            if (op != sjtu::trace::op_clear) hashes.push_back(hash);
+        }
+        std::fclose(in);
+        std::sort(hashes.begin(), hashes.end());
+        hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+        std::vector<Recorded> keys;
+        for (size_t i = 0; i < hashes.size(); ++i) keys.push_back(Recorded{hashes[i]});
+        analyze<Recorded, RecordedHash>("recorded hashes", keys);
+        return 0;
+    }
+
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    std::vector<int> sequential, strided, random;
+    std::vector<std::string> strings;
+    unsigned long long x = 88172645463325252ULL;
+    for (size_t i = 0; i < n; ++i) {
+        sequential.push_back(int(i));
+        strided.push_back(int(i * 1024));
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        random.push_back(int(x));
+        strings.push_back("user:" + std::to_string(i));
+    }
+    // xorshift can repeat in 32 bits; the analysis wants distinct keys
+    std::sort(random.begin(), random.end());
+    random.erase(std::unique(random.begin(), random.end()), random.end());
+
+    analyze<int, TruncatedHash>("tests' Hash, sequential ints", sequential);
+    analyze<int, TruncatedHash>("tests' Hash, ints strided by 1024", strided);
+    analyze<int, TruncatedHash>("tests' Hash, random ints", random);
+    analyze<int, sjtu::fmix_hash<TruncatedHash>>("fmix_hash of tests' Hash, ints strided by 1024", strided);
+    analyze<std::string, std::hash<std::string>>("std::hash<std::string>, numbered strings", strings);
+    return 0;
+}
@@ -0,0 +1,233 @@
+/**
+ * how well a Hash functor spreads a sample of keys over hash tables.
+ *
+ *     sjtu::hash_quality_report report = sjtu::analyze_hash(keys, n, Hash());
+ *     sjtu::print_report(report, stdout);
+ *
+ * The sample is placed in a table sized like linked_hashmap's for that many
+ * keys (a power of two at most 3/4 full), reduced to buckets three ways:
+ * masking off the low bits, modulo a prime, and the high bits of a
+ * Fibonacci multiply as linked_hashmap does. Each is compared against a
+ * uniformly random hash of the same keys. For integral keys the avalanche
+ * of the functor is measured too: flipping one key bit should flip each
+ * hash bit half the time.
+ *
+ * Keys in the sample are taken to be distinct.
+ */
+#ifndef SJTU_HASH_QUALITY_HPP
+#define SJTU_HASH_QUALITY_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <type_traits>
+#include <vector>
+
+namespace sjtu {
+    /**
+     * wraps a Hash with the 64-bit MurmurHash3 finalizer, which gives full
+     * avalanche; the usual fix for identity and truncated hashes.
+     */
+    template<class Hash>
+    struct fmix_hash {
+        Hash inner;
+
+        template<class Key>
+        size_t operator()(const Key &key) const {
+            unsigned long long h = inner(key);
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53ULL;
+            h ^= h >> 33;
+            return h;
+        }
+    };
+
+    struct hash_reduction_report {
+        const char *name;
+        size_t buckets;
+        // buckets holding 0, 1, ... 8 keys, and 9 or more in the last
+        size_t occupancy[10];
+        size_t longest;
+        // keys that share a bucket with an earlier key, and how many a
+        // uniformly random hash would give
+        size_t collisions;
+        double expected_collisions;
+        // mean chain length walked by a successful lookup, actual and uniform
+        double probe_length;
+        double expected_probe_length;
+    };
+
+    struct hash_quality_report {
+        size_t keys;
+        size_t distinct_hashes;
+        // the hash never sets bits at or above this one
+        int output_bits;
+        // bits below output_bits that are the same for every key
+        unsigned long long stuck_bits;
+        // mean and worst |P(hash bit flips | key bit flips) - 1/2| * 2 over
+        // all key bit and hash bit pairs: 0 is ideal, 1 is no mixing;
+        // -1 when the key is not integral
+        double avalanche_bias;
+        double worst_avalanche_bias;
+        hash_reduction_report mask;
+        hash_reduction_report modulo;
+        hash_reduction_report fibonacci;
+        const char *recommendation;
+    };
+
+    namespace hash_quality_detail {
+        inline size_t next_prime(size_t n) {
+            for (;; ++n) {
+                bool prime = n >= 2;
+                for (size_t d = 2; d * d <= n && prime; ++d) prime = n % d != 0;
+                if (prime) return n;
+            }
+        }
+
+        inline hash_reduction_report reduce(const char *name, const std::vector<unsigned long long> &hashes,
+                                            size_t buckets, int mode) {
+            hash_reduction_report report = {};
+            report.name = name;
+            report.buckets = buckets;
+            int shift = 0;
+            while ((size_t(1) << shift) < buckets) ++shift;
+            std::vector<size_t> chains(buckets, 0);
+            for (size_t i = 0; i < hashes.size(); ++i) {
+                unsigned long long h = hashes[i];
+                size_t index = mode == 0 ? h & (buckets - 1)
+                             : mode == 1 ? h % buckets
+                                         : (h * 0x9e3779b97f4a7c15ULL) >> (64 - shift);
+                chains[index]++;
+            }
+            double walked = 0;
+            size_t occupied = 0;
+            for (size_t b = 0; b < buckets; ++b) {
+                size_t c = chains[b];
+                report.occupancy[c < 9 ? c : 9]++;
+                if (c > report.longest) report.longest = c;
+                if (c) occupied++;
+                walked += c * (c + 1) / 2.0;
+            }
+            double n = double(hashes.size());
+            double m = double(buckets);
+            report.collisions = hashes.size() - occupied;
+            report.expected_collisions = n - m * (1 - std::pow(1 - 1 / m, n));
+            report.probe_length = n ? walked / n : 0;
+            report.expected_probe_length = 1 + (n - 1) / (2 * m);
+            return report;
+        }
+
+        // clustered buckets cost more than this over uniform before a
+        // reduction counts as bad
+        static const double PROBE_SLACK = 1.25;
+        static const double AVALANCHE_LIMIT = 0.1;
+
+        inline bool poor(const hash_reduction_report &r) {
+            return r.probe_length > r.expected_probe_length * PROBE_SLACK;
+        }
+    }
+
+    /**
+     * analyze hash over keys[0..n). buckets is the table size to model;
+     * 0 sizes it as linked_hashmap would for n keys.
+     */
+    template<class Key, class Hash>
+    hash_quality_report analyze_hash(const Key *keys, size_t n, const Hash &hash = Hash(), size_t buckets = 0) {
+        using namespace hash_quality_detail;
+        hash_quality_report report = {};
+        report.keys = n;
+        if (!buckets) {
+            buckets = 16;
+            while (n >= buckets * 0.75) buckets *= 2;
+        }
+
+        std::vector<unsigned long long> hashes(n);
+        unsigned long long any = 0, all = ~0ULL;
+        for (size_t i = 0; i < n; ++i) {
+            hashes[i] = hash(keys[i]);
+            any |= hashes[i];
+            all &= hashes[i];
+        }
+        while (report.output_bits < 64 && (any >> report.output_bits)) report.output_bits++;
+        unsigned long long width = report.output_bits == 64 ? ~0ULL : (1ULL << report.output_bits) - 1;
+        report.stuck_bits = n ? ~(any & ~all) & width : 0;
+
+        std::vector<unsigned long long> sorted(hashes);
+        std::sort(sorted.begin(), sorted.end());
+        report.distinct_hashes = std::unique(sorted.begin(), sorted.end()) - sorted.begin();
+
+        report.mask = reduce("mask", hashes, buckets, 0);
+        report.modulo = reduce("modulo", hashes, next_prime(buckets), 1);
+        report.fibonacci = reduce("fibonacci", hashes, buckets, 2);
+
+        report.avalanche_bias = report.worst_avalanche_bias = -1;
+        if constexpr (std::is_integral<Key>::value && !std::is_same<Key, bool>::value) {
+            typedef typename std::make_unsigned<Key>::type Bits;
+            const int key_bits = sizeof(Key) * 8;
+            const int out_bits = report.output_bits ? report.output_bits : 1;
+            size_t samples = n < 1000 ? n : 1000;
+            std::vector<size_t> flips(key_bits * out_bits, 0);
+            for (size_t s = 0; s < samples; ++s) {
+                const Key &key = keys[s * n / samples];
+                unsigned long long h = hash(key);
+                for (int i = 0; i < key_bits; ++i) {
+                    Key flipped = Key(Bits(key) ^ (Bits(1) << i));
+                    unsigned long long diff = h ^ (unsigned long long)hash(flipped);
+                    for (int j = 0; j < out_bits; ++j) flips[i * out_bits + j] += (diff >> j) & 1;
+                }
+            }
+            if (samples) {
+                double total = 0, worst = 0;
+                for (size_t k = 0; k < flips.size(); ++k) {
+                    double bias = std::fabs(double(flips[k]) / samples - 0.5) * 2;
+                    total += bias;
+                    if (bias > worst) worst = bias;
+                }
+                report.avalanche_bias = total / flips.size();
+                report.worst_avalanche_bias = worst;
+            }
+        }
+
+        if (report.distinct_hashes < n) {
+            report.recommendation = "distinct keys share hash values, which no mixer can separate; hash more of the key";
+        } else if (poor(report.fibonacci)) {
+            report.recommendation = "even the map's Fibonacci reduction clusters; wrap the hash in fmix_hash";
+        } else if (poor(report.mask) || poor(report.modulo)) {
+            report.recommendation = "the low bits are structured: linked_hashmap copes, but wrap the hash in "
+                                    "fmix_hash for tables that mask or take a modulo";
+        } else if (report.avalanche_bias > AVALANCHE_LIMIT) {
+            report.recommendation = "spreads this sample, but with weak avalanche; wrap the hash in fmix_hash "
+                                    "if the keys may change shape";
+        } else {
+            report.recommendation = "no mixer needed";
+        }
+        return report;
+    }
+
+    inline void print_report(const hash_quality_report &report, std::FILE *out) {
+        std::fprintf(out, "keys %zu, distinct hashes %zu, output bits %d, stuck bits %016llx\n",
+                     report.keys, report.distinct_hashes, report.output_bits, report.stuck_bits);
+        if (report.avalanche_bias >= 0) {
+            std::fprintf(out, "avalanche bias %.3f mean, %.3f worst\n",
+                         report.avalanche_bias, report.worst_avalanche_bias);
+        } else {
+            std::fprintf(out, "avalanche not measured (key is not integral)\n");
+        }
+        std::fprintf(out, "%-10s %8s %8s %8s %8s %8s %8s  %s\n", "reduction", "buckets", "longest",
+                     "collide", "uniform", "probe", "uniform", "buckets with 0..8, 9+ keys");
+        const hash_reduction_report *rows[3] = {&report.mask, &report.modulo, &report.fibonacci};
+        for (int r = 0; r < 3; ++r) {
+            const hash_reduction_report &row = *rows[r];
+            std::fprintf(out, "%-10s %8zu %8zu %8zu %8.0f %8.3f %8.3f ", row.name, row.buckets, row.longest,
+                         row.collisions, row.expected_collisions, row.probe_length, row.expected_probe_length);
+            for (int c = 0; c < 10; ++c) std::fprintf(out, " %zu", row.occupancy[c]);
+            std::fprintf(out, "\n");
+        }
+        std::fprintf(out, "recommendation: %s\n", report.recommendation);
+    }
+}
+
+#endif
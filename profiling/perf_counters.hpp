@@ -0,0 +1,212 @@
+/**
+ * hardware performance counters per linked_hashmap operation, read with
+ * perf_event_open (Linux only).
+ *
+ * Include this header before any map header; it fills the
+ * SJTU_LINKED_HASHMAP_REGION hook, so that find_node, insert_node,
+ * erase_node and rehash each run inside a counter region:
+ *
+ *     #include "profiling/perf_counters.hpp"
+ *     #include "linked_hashmap.hpp"
+ *     ...
+ *     if (sjtu::perf::enable()) { run(); sjtu::perf::report(stdout); }
+ *
+ * While disabled a region costs one load and branch. While enabled it
+ * costs two read() calls on the thread's counter group, which dwarfs a
+ * cached lookup in wall time but not in the user-space counts, since the
+ * counters exclude the kernel. Regions nest (an insert that rehashes
+ * counts the rehash too), and counts from all threads are summed.
+ * count_batch() and find_batch() walk their chains outside find_node, so
+ * their lookups are not counted.
+ */
+#ifndef SJTU_PERF_COUNTERS_HPP
+#define SJTU_PERF_COUNTERS_HPP
+
+#ifdef SJTU_LINKEDHASHMAP_HPP
+#error "perf_counters.hpp must come before linked_hashmap.hpp, or its regions are compiled out"
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace sjtu {
+namespace perf {
+    enum operation { op_find, op_insert, op_erase, op_rehash, OPERATIONS };
+
+    enum event { cycles, instructions, cache_misses, dtlb_misses, branch_misses, EVENTS };
+
+    /**
+     * averages per call of one operation; an event the CPU or kernel
+     * could not count is -1.
+     */
+    struct stats {
+        unsigned long long calls;
+        double events[EVENTS];
+    };
+
+    namespace detail {
+        inline bool enabled = false;
+        inline bool counted[EVENTS] = {};
+        inline unsigned long long calls[OPERATIONS] = {};
+        inline unsigned long long totals[OPERATIONS][EVENTS] = {};
+
+        inline const char* const operation_names[OPERATIONS] = {"find", "insert", "erase", "rehash"};
+        inline const char* const event_names[EVENTS] = {
+            "cycles", "instructions", "cache-misses", "dTLB-misses", "branch-misses"
+        };
+
+        // the calling thread's counter group; slot[e] is e's place in a
+        // group read, or -1 if it did not open
+        struct group {
+            int leader;
+            int fds[EVENTS];
+            int slot[EVENTS];
+            int opened;
+            bool tried;
+        };
+
+        inline thread_local group counters = {-1, {-1, -1, -1, -1, -1}, {-1, -1, -1, -1, -1}, 0, false};
+
+        inline int open_event(unsigned type, unsigned long long config, int group_fd) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = config;
+            attr.disabled = group_fd < 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+        }
+
+        inline bool open_group() {
+            group& g = counters;
+            if (g.tried) return g.leader >= 0;
+            g.tried = true;
+            const unsigned types[EVENTS] = {
+                PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE
+            };
+            const unsigned long long configs[EVENTS] = {
+                PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+                PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+                PERF_COUNT_HW_BRANCH_MISSES
+            };
+            for (int e = 0; e < EVENTS; ++e) {
+                g.fds[e] = open_event(types[e], configs[e], g.leader);
+                if (g.fds[e] < 0) continue;
+                if (g.leader < 0) g.leader = g.fds[e];
+                g.slot[e] = g.opened++;
+                __atomic_store_n(&counted[e], true, __ATOMIC_RELAXED);
+            }
+            if (g.leader < 0) return false;
+            ioctl(g.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(g.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            return true;
+        }
+
+        // values[0] is the number of counters, then one value each
+        inline bool read_group(unsigned long long* values) {
+            ssize_t want = (ssize_t)sizeof(unsigned long long) * (1 + counters.opened);
+            return read(counters.leader, values, want) == want;
+        }
+    }
+
+    /**
+     * open the calling thread's counters and start counting regions.
+     * Returns false, leaving counting off, if perf_event_open is not
+     * permitted (see /proc/sys/kernel/perf_event_paranoid) or the CPU
+     * has no counters. Other threads open theirs on first use.
+     */
+    inline bool enable() {
+        if (!detail::open_group()) return false;
+        __atomic_store_n(&detail::enabled, true, __ATOMIC_RELAXED);
+        return true;
+    }
+
+    inline void disable() {
+        __atomic_store_n(&detail::enabled, false, __ATOMIC_RELAXED);
+    }
+
+    inline void reset() {
+        for (int op = 0; op < OPERATIONS; ++op) {
+            __atomic_store_n(&detail::calls[op], 0, __ATOMIC_RELAXED);
+            for (int e = 0; e < EVENTS; ++e) __atomic_store_n(&detail::totals[op][e], 0, __ATOMIC_RELAXED);
+        }
+    }
+
+    inline stats average(operation op) {
+        stats result;
+        result.calls = __atomic_load_n(&detail::calls[op], __ATOMIC_RELAXED);
+        for (int e = 0; e < EVENTS; ++e) {
+            if (!__atomic_load_n(&detail::counted[e], __ATOMIC_RELAXED)) {
+                result.events[e] = -1;
+            } else {
+                unsigned long long total = __atomic_load_n(&detail::totals[op][e], __ATOMIC_RELAXED);
+                result.events[e] = result.calls ? double(total) / result.calls : 0;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * print one line per operation with its calls and per-call averages.
+     */
+    inline void report(std::FILE* out) {
+        std::fprintf(out, "%-8s %12s", "op", "calls");
+        for (int e = 0; e < EVENTS; ++e) std::fprintf(out, " %14s", detail::event_names[e]);
+        std::fprintf(out, "\n");
+        for (int op = 0; op < OPERATIONS; ++op) {
+            stats s = average(operation(op));
+            std::fprintf(out, "%-8s %12llu", detail::operation_names[op], s.calls);
+            for (int e = 0; e < EVENTS; ++e) {
+                if (s.events[e] < 0) {
+                    std::fprintf(out, " %14s", "n/a");
+                } else {
+                    std::fprintf(out, " %14.2f", s.events[e]);
+                }
+            }
+            std::fprintf(out, "\n");
+        }
+    }
+
+    /**
+     * adds the counts between construction and destruction to op.
+     */
+    class region {
+        operation op;
+        bool active;
+        unsigned long long start[1 + EVENTS];
+
+    public:
+        explicit region(operation o) : op(o), active(false) {
+            if (!__atomic_load_n(&detail::enabled, __ATOMIC_RELAXED)) return;
+            active = detail::open_group() && detail::read_group(start);
+        }
+
+        region(const region &) = delete;
+        region & operator=(const region &) = delete;
+
+        ~region() {
+            if (!active) return;
+            unsigned long long end[1 + EVENTS];
+            if (!detail::read_group(end)) return;
+            __atomic_add_fetch(&detail::calls[op], 1, __ATOMIC_RELAXED);
+            for (int e = 0; e < EVENTS; ++e) {
+                int slot = detail::counters.slot[e];
+                if (slot < 0) continue;
+                __atomic_add_fetch(&detail::totals[op][e], end[1 + slot] - start[1 + slot], __ATOMIC_RELAXED);
+            }
+        }
+    };
+}
+}
+
+#define SJTU_LINKED_HASHMAP_REGION(operation) \
+    ::sjtu::perf::region sjtu_perf_region(::sjtu::perf::op_##operation)
+
+#endif
@@ -0,0 +1,171 @@
+/**
+ * replay a recorded operation trace (see trace_recorder.hpp) against map
+ * engines and configurations, and report throughput and latency.
+ *
+ *   linked_hashmap_replay <trace> [engine ...]
+ *
+ * engines:
+ *   linked           linked_hashmap as it comes
+ *   linked-filter    with the Bloom filter on
+ *   linked-maintain  auto-grow off, maintain(256) every 64 operations, its
+ *                    time billed to the operation it follows
+ *   cuckoo           cuckoo_linked_hashmap
+ * With no engine named, all of them run.
+ *
+ * Keys are the recorded hashes themselves, which std::hash maps back to
+ * the same hash, so every engine sees the recorded bucket pattern. Each
+ * engine replays the trace twice on a fresh map: once untimed per
+ * operation for throughput, and once timing every operation for the
+ * latency percentiles.
+ */
+#include "linked_hashmap.hpp"
+#include "cuckoo_linked_hashmap.hpp"
+#include "trace_format.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+struct Record {
+    int op;
+    unsigned long long key;
+};
+
+static unsigned long long sink = 0;
+
+template<class Map>
+static void apply(Map &map, const Record &record, unsigned long long i) {
+    switch (record.op) {
+    case sjtu::trace::op_find:
+        sink += map.find(record.key) != map.end();
+        break;
+    case sjtu::trace::op_count:
+        sink += map.count(record.key);
+        break;
+    case sjtu::trace::op_at:
+        try {
+            sink += map.at(record.key);
+        } catch (sjtu::index_out_of_bound &) {}
+        break;
+    case sjtu::trace::op_access:
+        map[record.key] = i;
+        break;
+    case sjtu::trace::op_insert:
+        map.insert(typename Map::value_type(record.key, i));
+        break;
+    case sjtu::trace::op_erase: {
+        typename Map::iterator it = map.find(record.key);
+        if (it != map.end()) map.erase(it);
+        break;
+    }
+    case sjtu::trace::op_clear:
+        map.clear();
+        break;
+    }
+}
+
+template<class Map>
+struct Engine {
+    const char *name;
+    void (*setup)(Map &);
+    // call maintain() after every this many operations; 0 never
+    size_t maintain_every;
+};
+
+// the between-operations work of engines that have any
+template<class Map>
+static void upkeep(Map &) {}
+
+static void upkeep(sjtu::linked_hashmap<unsigned long long, unsigned long long> &map) {
+    map.maintain(256);
+}
+
+static double percentile(std::vector<float> &samples, double p) {
+    if (samples.empty()) return 0;
+    size_t rank = (size_t)(p * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+}
+
+template<class Map>
+static void replay(const Engine<Map> &engine, const std::vector<Record> &trace) {
+    {
+        Map map;
+        if (engine.setup) engine.setup(map);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < trace.size(); ++i) {
+            apply(map, trace[i], i);
+            if (engine.maintain_every && i % engine.maintain_every == engine.maintain_every - 1) {
+                upkeep(map);
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("%-16s %12.0f ops/s  (%zu entries left)\n", engine.name,
+                    seconds > 0 ? trace.size() / seconds : 0.0, map.size());
+    }
+
+    std::vector<float> latencies[sjtu::trace::OPERATIONS];
+    Map map;
+    if (engine.setup) engine.setup(map);
+    for (size_t i = 0; i < trace.size(); ++i) {
+        auto start = std::chrono::steady_clock::now();
+        apply(map, trace[i], i);
+        if (engine.maintain_every && i % engine.maintain_every == engine.maintain_every - 1) {
+            upkeep(map);
+        }
+        latencies[trace[i].op].push_back(
+            std::chrono::duration<float, std::nano>(std::chrono::steady_clock::now() - start).count());
+    }
+    for (int op = 1; op < sjtu::trace::OPERATIONS; ++op) {
+        std::vector<float> &samples = latencies[op];
+        if (samples.empty()) continue;
+        double worst = *std::max_element(samples.begin(), samples.end());
+        std::printf("  %-8s %10zu ops   p50 %8.0f ns   p99 %8.0f ns   p99.9 %8.0f ns   max %10.0f ns\n",
+                    sjtu::trace::operation_name(op), samples.size(), percentile(samples, 0.5),
+                    percentile(samples, 0.99), percentile(samples, 0.999), worst);
+    }
+}
+
+static bool wanted(const char *name, int argc, char *argv[]) {
+    if (argc <= 2) return true;
+    for (int i = 2; i < argc; ++i) {
+        if (!std::strcmp(argv[i], name)) return true;
+    }
+    return false;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <trace> [engine ...]\n", argv[0]);
+        return 1;
+    }
+    std::FILE *in = std::fopen(argv[1], "rb");
+    if (!in || !sjtu::trace::read_magic(in)) {
+        std::fprintf(stderr, "%s: not a trace\n", argv[1]);
+        return 1;
+    }
+    std::vector<Record> trace;
+    Record record;
+    while (sjtu::trace::decode(in, record.op, record.key)) trace.push_back(record);
+    bool complete = std::feof(in);
+    std::fclose(in);
+    if (!complete) {
+        std::fprintf(stderr, "%s: malformed record after %zu operations; replaying those\n", argv[1], trace.size());
+    }
+    std::printf("%zu operations\n", trace.size());
+
+    typedef sjtu::linked_hashmap<unsigned long long, unsigned long long> Linked;
+    typedef sjtu::cuckoo_linked_hashmap<unsigned long long, unsigned long long> Cuckoo;
+    const Engine<Linked> linked[] = {
+        {"linked", nullptr, 0},
+        {"linked-filter", [](Linked &map) { map.enable_filter(); }, 0},
+        {"linked-maintain", [](Linked &map) { map.enable_auto_grow(false); }, 64},
+    };
+    for (const Engine<Linked> &engine : linked) {
+        if (wanted(engine.name, argc, argv)) replay(engine, trace);
+    }
+    const Engine<Cuckoo> cuckoo = {"cuckoo", nullptr, 0};
+    if (wanted(cuckoo.name, argc, argv)) replay(cuckoo, trace);
+    return 0;
+}
@@ -0,0 +1,69 @@
+/**
+ * the binary operation trace written by trace_recorder.hpp and read by
+ * linked_hashmap_replay.
+ *
+ * A trace is the 8-byte magic "SJTUTRC1" followed by one record per
+ * operation: a byte with the operation code, then the key's hash as an
+ * unsigned LEB128 varint (clear records carry 0). Small integer keys,
+ * whose std::hash is the key itself, take two or three bytes a record.
+ */
+#ifndef SJTU_TRACE_FORMAT_HPP
+#define SJTU_TRACE_FORMAT_HPP
+
+#include <cstdio>
+#include <cstring>
+
+namespace sjtu {
+namespace trace {
+    enum operation { op_find = 1, op_count, op_at, op_access, op_insert, op_erase, op_clear, OPERATIONS };
+
+    static const char MAGIC[8] = {'S', 'J', 'T', 'U', 'T', 'R', 'C', '1'};
+
+    inline const char* operation_name(int op) {
+        static const char* const names[OPERATIONS] = {
+            "?", "find", "count", "at", "access", "insert", "erase", "clear"
+        };
+        return op > 0 && op < OPERATIONS ? names[op] : names[0];
+    }
+
+    /**
+     * encode one record into out, which needs 11 bytes; returns its length.
+     */
+    inline size_t encode(int op, unsigned long long hash, unsigned char* out) {
+        size_t length = 0;
+        out[length++] = (unsigned char)op;
+        do {
+            unsigned char byte = hash & 0x7f;
+            hash >>= 7;
+            out[length++] = byte | (hash ? 0x80 : 0);
+        } while (hash);
+        return length;
+    }
+
+    /**
+     * read the next record. Returns false at the end of the trace, or if
+     * the record is cut short or malformed.
+     */
+    inline bool decode(std::FILE* in, int& op, unsigned long long& hash) {
+        int c = std::getc(in);
+        if (c == EOF) return false;
+        op = c;
+        if (op <= 0 || op >= OPERATIONS) return false;
+        hash = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            c = std::getc(in);
+            if (c == EOF) return false;
+            hash |= (unsigned long long)(c & 0x7f) << shift;
+            if (!(c & 0x80)) return true;
+        }
+        return false;
+    }
+
+    inline bool read_magic(std::FILE* in) {
+        char magic[8];
+        return std::fread(magic, 1, 8, in) == 8 && !std::memcmp(magic, MAGIC, 8);
+    }
+}
+}
+
+#endif
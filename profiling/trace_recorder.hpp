@@ -0,0 +1,89 @@
+/**
+ * operation trace recorder for linked_hashmap.
+ *
+ * Include this header before any map header; it fills the
+ * SJTU_LINKED_HASHMAP_TRACE hook, so that each public lookup and update
+ * appends a record (operation and key hash, see trace_format.hpp) to the
+ * trace while recording:
+ *
+ *     #include "profiling/trace_recorder.hpp"
+ *     #include "linked_hashmap.hpp"
+ *     ...
+ *     sjtu::trace::start("workload.trace", &sessions);
+ *     serve();
+ *     sjtu::trace::stop();
+ *
+ * A trace describes one map: pass it to start() to record only that one,
+ * or nullptr to record every map into the same stream. Only hashes are
+ * kept, never keys or values, so a trace can leave the machine it was
+ * recorded on. Recording appends under a lock; stopped, the hook costs
+ * one load and branch.
+ */
+#ifndef SJTU_TRACE_RECORDER_HPP
+#define SJTU_TRACE_RECORDER_HPP
+
+#ifdef SJTU_LINKEDHASHMAP_HPP
+#error "trace_recorder.hpp must come before linked_hashmap.hpp, or its hook is compiled out"
+#endif
+
+#include <cstdio>
+#include <mutex>
+#include "trace_format.hpp"
+
+namespace sjtu {
+namespace trace {
+    namespace detail {
+        inline std::FILE* out = nullptr;
+        inline const void* only = nullptr;
+        inline unsigned long long records = 0;
+        inline std::mutex lock;
+
+        inline void record(const void* map, int op, unsigned long long hash) {
+            if (!__atomic_load_n(&out, __ATOMIC_ACQUIRE)) return;
+            std::lock_guard<std::mutex> guard(lock);
+            if (!out || (only && map != only)) return;
+            unsigned char buffer[11];
+            size_t length = encode(op, hash, buffer);
+            std::fwrite(buffer, 1, length, out);
+            records++;
+        }
+    }
+
+    /**
+     * start recording into a new file at path, only the operations on map
+     * if it is given. Returns false if the file cannot be created or a
+     * recording is already running.
+     */
+    inline bool start(const char* path, const void* map = nullptr) {
+        std::lock_guard<std::mutex> guard(detail::lock);
+        if (detail::out) return false;
+        std::FILE* file = std::fopen(path, "wb");
+        if (!file) return false;
+        if (std::fwrite(MAGIC, 1, 8, file) != 8) {
+            std::fclose(file);
+            return false;
+        }
+        detail::only = map;
+        detail::records = 0;
+        __atomic_store_n(&detail::out, file, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    /**
+     * stop recording and close the trace. Returns the number of records,
+     * or 0 if nothing was recording.
+     */
+    inline unsigned long long stop() {
+        std::lock_guard<std::mutex> guard(detail::lock);
+        if (!detail::out) return 0;
+        std::fclose(detail::out);
+        __atomic_store_n(&detail::out, (std::FILE*)nullptr, __ATOMIC_RELEASE);
+        return detail::records;
+    }
+}
+}
+
+#define SJTU_LINKED_HASHMAP_TRACE(map, operation, hash) \
+    ::sjtu::trace::detail::record(map, ::sjtu::trace::op_##operation, hash)
+
+#endif
@@ -0,0 +1,569 @@
+/**
+ * implement a linked_hashmap that lives in POSIX shared memory
+ */
+#ifndef SJTU_SHM_LINKEDHASHMAP_HPP
+#define SJTU_SHM_LINKEDHASHMAP_HPP
+
+// only for std::equal_to<T> and std::hash<T>
+#include <functional>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "exceptions.hpp"
+
+namespace sjtu {
+    /**
+     * shm_linked_hashmap keeps its buckets and nodes in one named POSIX
+     * shared-memory segment, so that several processes on a host share a
+     * single copy of a large map instead of each building its own:
+     *
+     *     auto map = sjtu::shm_linked_hashmap<long, double>::create("/prices", 1 << 20);
+     *     // in the other processes
+     *     auto map = sjtu::shm_linked_hashmap<long, double>::open("/prices");
+     *
+     * Links are node indices rather than pointers, so the segment may be
+     * mapped at a different address in every process. The capacity is fixed
+     * when the segment is created.
+     *
+     * Writers serialize on a robust process-shared mutex; if a writer dies
+     * holding it, the next one rebuilds the index from the entry list.
+     * Readers take no lock: a seqlock tells them to retry when a write
+     * overlapped, so lookups copy their result out instead of returning
+     * references into the segment.
+     *
+     * Key and T must be trivially copyable, and Hash must give the same
+     * value for the same key in every process.
+     */
+
+template<
+	class Key,
+	class T,
+	class Hash = std::hash<Key>,
+	class Equal = std::equal_to<Key>
+> class shm_linked_hashmap {
+public:
+	struct value_type {
+		Key first;
+		T second;
+	};
+
+	static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<T>::value,
+	              "shm_linked_hashmap stores Key and T as raw bytes");
+
+private:
+    // links are node index + 1, so that 0 means none
+    struct Node {
+        unsigned prev;
+        unsigned next;
+        unsigned hash_next;
+        unsigned live;
+        unsigned long long hash;
+        value_type data;
+    };
+
+    struct Header {
+        unsigned long long magic;
+        unsigned long long capacity;
+        unsigned long long bucket_count;
+        unsigned long long node_size;
+        unsigned long long total_size;
+        unsigned long long seed;
+        unsigned long long element_count;
+        // odd while a write is in progress
+        unsigned long long sequence;
+        unsigned head;
+        unsigned tail;
+        unsigned free_head;
+        pthread_mutex_t lock;
+    };
+
+    static const unsigned long long MAGIC = 0x314d485355544a53ULL;  // "SJTUSHM1"
+
+    unsigned char* segment;
+    size_t segment_size;
+    Header* header;
+    unsigned* buckets;
+    Node* nodes;
+    Hash hash_func;
+    Equal equal_func;
+
+    static unsigned long long mix_hash(unsigned long long h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    static size_t align64(size_t n) {
+        return (n + 63) & ~size_t(63);
+    }
+
+    static size_t bucket_count_for(size_t capacity) {
+        size_t count = 16;
+        while (count * 3 / 4 < capacity) count *= 2;
+        return count;
+    }
+
+    static size_t buckets_offset() {
+        return align64(sizeof(Header));
+    }
+
+    static size_t nodes_offset(size_t bucket_count) {
+        return align64(buckets_offset() + bucket_count * sizeof(unsigned));
+    }
+
+    /**
+     * whether size bytes at data hold a header for these types whose
+     * capacity and bucket count give exactly the layout create() makes,
+     * so that attach() stays inside the segment. Links are checked by the
+     * code that follows them.
+     */
+    static bool well_formed(const void* data, size_t size) {
+        const Header* h = static_cast<const Header*>(data);
+        if (__atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != MAGIC || h->node_size != sizeof(Node)
+            || h->total_size != size) {
+            return false;
+        }
+        // bounding capacity first keeps the size arithmetic below exact
+        return h->capacity < 0xffffffffu && h->bucket_count == bucket_count_for(h->capacity)
+            && nodes_offset(h->bucket_count) + h->capacity * sizeof(Node) == size;
+    }
+
+    shm_linked_hashmap() : segment(nullptr), segment_size(0), header(nullptr), buckets(nullptr), nodes(nullptr) {}
+
+    void attach(unsigned char* data, size_t size) {
+        segment = data;
+        segment_size = size;
+        header = reinterpret_cast<Header*>(segment);
+        buckets = reinterpret_cast<unsigned*>(segment + buckets_offset());
+        nodes = reinterpret_cast<Node*>(segment + nodes_offset(header->bucket_count));
+    }
+
+    void release() {
+        if (segment) munmap(segment, segment_size);
+        segment = nullptr;
+    }
+
+    /**
+     * shared fields are read by lock-free readers while a writer changes
+     * them, so every link goes through an atomic access.
+     */
+    static unsigned load(const unsigned& link) {
+        return __atomic_load_n(&link, __ATOMIC_RELAXED);
+    }
+
+    static void store(unsigned& link, unsigned value) {
+        __atomic_store_n(&link, value, __ATOMIC_RELAXED);
+    }
+
+    size_t bucket_of(unsigned long long h) const {
+        return mix_hash(h ^ header->seed) & (header->bucket_count - 1);
+    }
+
+    Node& node_at(unsigned link) const {
+        return nodes[link - 1];
+    }
+
+    /**
+     * the link of the node holding key, or 0. Writers call this under the
+     * lock; readers call it inside a seqlock section, where a concurrent
+     * write may hand them a stale link, hence the bounds on both the index
+     * and the walk.
+     */
+    unsigned find_link(const Key& key, unsigned long long h) const {
+        unsigned link = load(buckets[bucket_of(h)]);
+        for (size_t steps = 0; link && link <= header->capacity && steps < header->capacity; ++steps) {
+            const Node& node = node_at(link);
+            if (__atomic_load_n(&node.hash, __ATOMIC_RELAXED) == h) {
+                // compare a private copy; the shared one may be half-written
+                alignas(Key) unsigned char copy[sizeof(Key)];
+                std::memcpy(copy, &node.data.first, sizeof(Key));
+                if (equal_func(*reinterpret_cast<const Key*>(copy), key)) return link;
+            }
+            link = load(node.hash_next);
+        }
+        return 0;
+    }
+
+    /**
+     * run read(), retrying until no write overlapped it.
+     */
+    template<class Read>
+    bool read_consistent(Read read) const {
+        while (true) {
+            unsigned long long before = __atomic_load_n(&header->sequence, __ATOMIC_ACQUIRE);
+            if (before & 1) {
+#if defined(__x86_64__) || defined(__i386__)
+                __builtin_ia32_pause();
+#endif
+                continue;
+            }
+            bool result = read();
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&header->sequence, __ATOMIC_RELAXED) == before) return result;
+        }
+    }
+
+    void lock() const {
+        int rc = pthread_mutex_lock(&header->lock);
+        if (rc == EOWNERDEAD) {
+            const_cast<shm_linked_hashmap*>(this)->repair();
+            pthread_mutex_consistent(&header->lock);
+        } else if (rc != 0) {
+            throw runtime_error();
+        }
+    }
+
+    void unlock() const {
+        pthread_mutex_unlock(&header->lock);
+    }
+
+    void begin_write() {
+        lock();
+        __atomic_store_n(&header->sequence, header->sequence + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+    }
+
+    void end_write() {
+        __atomic_store_n(&header->sequence, header->sequence + 1, __ATOMIC_RELEASE);
+        unlock();
+    }
+
+    /**
+     * recover after a writer died holding the lock. The entry list is
+     * taken as the truth: every node on it is kept, the buckets, count and
+     * free list are rebuilt around it, and an interrupted insert or erase
+     * either happened completely or not at all.
+     */
+    void repair() {
+        size_t capacity = header->capacity;
+        for (size_t i = 0; i < capacity; ++i) nodes[i].live = 0;
+        for (size_t i = 0; i < header->bucket_count; ++i) store(buckets[i], 0);
+
+        unsigned prev = 0;
+        size_t count = 0;
+        for (unsigned link = header->head; link && link <= capacity && !node_at(link).live; link = node_at(link).next) {
+            Node& node = node_at(link);
+            node.live = 1;
+            node.prev = prev;
+            size_t bucket = bucket_of(node.hash);
+            store(node.hash_next, buckets[bucket]);
+            store(buckets[bucket], link);
+            prev = link;
+            ++count;
+        }
+        if (prev) {
+            node_at(prev).next = 0;
+        } else {
+            header->head = 0;
+        }
+        header->tail = prev;
+        header->element_count = count;
+
+        header->free_head = 0;
+        for (size_t i = capacity; i-- > 0; ) {
+            if (nodes[i].live) continue;
+            nodes[i].next = header->free_head;
+            header->free_head = i + 1;
+        }
+        if (header->sequence & 1) header->sequence++;
+    }
+
+    void format(size_t capacity, size_t bucket_count) {
+        header->capacity = capacity;
+        header->bucket_count = bucket_count;
+        header->node_size = sizeof(Node);
+        header->total_size = segment_size;
+        header->seed = mix_hash((unsigned long long)getpid() ^ (unsigned long long)this
+#if defined(__x86_64__) || defined(__i386__)
+                                ^ __builtin_ia32_rdtsc()
+#endif
+                                );
+        header->element_count = 0;
+        header->sequence = 0;
+        header->head = header->tail = 0;
+        for (size_t i = 0; i < bucket_count; ++i) buckets[i] = 0;
+        header->free_head = capacity ? 1 : 0;
+        for (size_t i = 0; i < capacity; ++i) {
+            nodes[i].live = 0;
+            nodes[i].next = i + 1 < capacity ? i + 2 : 0;
+        }
+
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&header->lock, &attr);
+        pthread_mutexattr_destroy(&attr);
+
+        // openers check the magic last, so it marks the segment ready
+        __atomic_store_n(&header->magic, MAGIC, __ATOMIC_RELEASE);
+    }
+
+    /**
+     * take a free node, fill it and link it at the tail. The caller has
+     * begun the write and checked that the map is not full.
+     */
+    void append(unsigned long long h, const Key& key, const T& value) {
+        unsigned link = header->free_head;
+        Node& node = node_at(link);
+        header->free_head = node.next;
+        node.hash = h;
+        std::memcpy(static_cast<void*>(&node.data.first), &key, sizeof(Key));
+        std::memcpy(static_cast<void*>(&node.data.second), &value, sizeof(T));
+        node.live = 1;
+        node.prev = header->tail;
+        node.next = 0;
+        if (header->tail) {
+            node_at(header->tail).next = link;
+        } else {
+            header->head = link;
+        }
+        header->tail = link;
+        size_t bucket = bucket_of(h);
+        store(node.hash_next, load(buckets[bucket]));
+        store(buckets[bucket], link);
+        header->element_count++;
+    }
+
+    void unlink(unsigned link) {
+        Node& node = node_at(link);
+        unsigned* slot = &buckets[bucket_of(node.hash)];
+        while (load(*slot) != link) slot = &node_at(load(*slot)).hash_next;
+        store(*slot, load(node.hash_next));
+
+        if (node.prev) {
+            node_at(node.prev).next = node.next;
+        } else {
+            header->head = node.next;
+        }
+        if (node.next) {
+            node_at(node.next).prev = node.prev;
+        } else {
+            header->tail = node.prev;
+        }
+
+        node.live = 0;
+        node.next = header->free_head;
+        header->free_head = link;
+        header->element_count--;
+    }
+
+public:
+	/**
+	 * create a segment named `name` (see shm_open) with room for
+	 * `capacity` elements, and map it.
+	 * throw runtime_error if it already exists or cannot be created.
+	 */
+	static shm_linked_hashmap create(const char *name, size_t capacity) {
+	    if (capacity >= 0xffffffffu) throw runtime_error();
+	    size_t bucket_count = bucket_count_for(capacity);
+	    size_t size = nodes_offset(bucket_count) + capacity * sizeof(Node);
+
+	    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	    if (fd < 0) throw runtime_error();
+	    if (ftruncate(fd, size) != 0) {
+	        ::close(fd);
+	        shm_unlink(name);
+	        throw runtime_error();
+	    }
+	    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	    ::close(fd);
+	    if (data == MAP_FAILED) {
+	        shm_unlink(name);
+	        throw runtime_error();
+	    }
+
+	    shm_linked_hashmap map;
+	    map.segment = static_cast<unsigned char*>(data);
+	    map.segment_size = size;
+	    map.header = reinterpret_cast<Header*>(map.segment);
+	    map.header->bucket_count = bucket_count;
+	    map.attach(map.segment, size);
+	    map.format(capacity, bucket_count);
+	    return map;
+	}
+
+	/**
+	 * map an existing segment created by create() with the same types.
+	 * throw runtime_error if it is missing, not ready, was made for other
+	 * types, or has a header that does not match its size.
+	 */
+	static shm_linked_hashmap open(const char *name) {
+	    int fd = shm_open(name, O_RDWR, 0);
+	    if (fd < 0) throw runtime_error();
+	    struct stat st;
+	    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header)) {
+	        ::close(fd);
+	        throw runtime_error();
+	    }
+	    void* data = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	    ::close(fd);
+	    if (data == MAP_FAILED) throw runtime_error();
+
+	    if (!well_formed(data, st.st_size)) {
+	        munmap(data, st.st_size);
+	        throw runtime_error();
+	    }
+	    shm_linked_hashmap map;
+	    map.attach(static_cast<unsigned char*>(data), st.st_size);
+	    return map;
+	}
+
+	/**
+	 * remove the segment's name. Processes that have it mapped keep using
+	 * it; the memory is freed when the last one unmaps it.
+	 */
+	static void remove(const char *name) {
+	    shm_unlink(name);
+	}
+
+	shm_linked_hashmap(shm_linked_hashmap &&other) : shm_linked_hashmap() {
+	    *this = static_cast<shm_linked_hashmap&&>(other);
+	}
+
+	shm_linked_hashmap & operator=(shm_linked_hashmap &&other) {
+	    if (this == &other) return *this;
+	    release();
+	    if (other.segment) attach(other.segment, other.segment_size);
+	    other.segment = nullptr;
+	    return *this;
+	}
+
+	shm_linked_hashmap(const shm_linked_hashmap &) = delete;
+	shm_linked_hashmap & operator=(const shm_linked_hashmap &) = delete;
+
+	/**
+	 * unmap the segment. The data stays for the other processes.
+	 */
+	~shm_linked_hashmap() {
+	    release();
+	}
+
+	/**
+	 * copy the value mapped to key into value. Lock-free.
+	 * return false if such key does not exist.
+	 */
+	bool get(const Key &key, T &value) const {
+	    unsigned long long h = hash_func(key);
+	    return read_consistent([&]() {
+	        unsigned link = find_link(key, h);
+	        if (link) std::memcpy(static_cast<void*>(&value), &node_at(link).data.second, sizeof(T));
+	        return link != 0;
+	    });
+	}
+
+	/**
+	 * the value mapped to key, by value. Lock-free.
+	 * throw index_out_of_bound if such key does not exist.
+	 */
+	T at(const Key &key) const {
+	    alignas(T) unsigned char value[sizeof(T)];
+	    if (!get(key, *reinterpret_cast<T*>(value))) throw index_out_of_bound();
+	    return *reinterpret_cast<T*>(value);
+	}
+
+	size_t count(const Key &key) const {
+	    unsigned long long h = hash_func(key);
+	    return read_consistent([&]() { return find_link(key, h) != 0; }) ? 1 : 0;
+	}
+
+	size_t size() const {
+	    return __atomic_load_n(&header->element_count, __ATOMIC_RELAXED);
+	}
+
+	bool empty() const {
+	    return size() == 0;
+	}
+
+	size_t capacity() const {
+	    return header->capacity;
+	}
+
+	/**
+	 * insert value if its key is absent.
+	 * return true if inserted, false if the key was already there.
+	 * throw runtime_error if the map is full.
+	 */
+	bool insert(const value_type &value) {
+	    unsigned long long h = hash_func(value.first);
+	    begin_write();
+	    bool inserted = !find_link(value.first, h);
+	    if (inserted && !header->free_head) {
+	        end_write();
+	        throw runtime_error();
+	    }
+	    if (inserted) append(h, value.first, value.second);
+	    end_write();
+	    return inserted;
+	}
+
+	/**
+	 * map key to value, inserting it at the end if absent.
+	 * throw runtime_error if the key is absent and the map is full.
+	 */
+	void set(const Key &key, const T &value) {
+	    unsigned long long h = hash_func(key);
+	    begin_write();
+	    unsigned link = find_link(key, h);
+	    if (link) {
+	        std::memcpy(static_cast<void*>(&node_at(link).data.second), &value, sizeof(T));
+	    } else if (header->free_head) {
+	        append(h, key, value);
+	    } else {
+	        end_write();
+	        throw runtime_error();
+	    }
+	    end_write();
+	}
+
+	/**
+	 * erase the element with key.
+	 * return false if such key does not exist.
+	 */
+	bool erase(const Key &key) {
+	    unsigned long long h = hash_func(key);
+	    begin_write();
+	    unsigned link = find_link(key, h);
+	    if (link) unlink(link);
+	    end_write();
+	    return link != 0;
+	}
+
+	void clear() {
+	    begin_write();
+	    while (header->head) unlink(header->head);
+	    end_write();
+	}
+
+	/**
+	 * call f(key, value) for every element in insertion order. Writers
+	 * wait until it returns, so f must not modify this map.
+	 */
+	template<class F>
+	void for_each(F f) const {
+	    lock();
+	    try {
+	        for (unsigned link = header->head; link; link = node_at(link).next) {
+	            const Node& node = node_at(link);
+	            f(node.data.first, node.data.second);
+	        }
+	    } catch (...) {
+	        unlock();
+	        throw;
+	    }
+	    unlock();
+	}
+};
+
+}
+
+#endif
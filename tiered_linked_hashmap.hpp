@@ -0,0 +1,422 @@
+/**
+ * implement a linked_hashmap that spills its coldest values to disk
+ */
+#ifndef SJTU_TIERED_LINKEDHASHMAP_HPP
+#define SJTU_TIERED_LINKEDHASHMAP_HPP
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include "linked_hashmap.hpp"
+
+namespace sjtu {
+    /**
+     * how tiered_linked_hashmap turns a value into segment bytes and back.
+     * The default copies trivially copyable values as they are; other
+     * types need a specialization, such as the one for std::string below.
+     */
+    template<class T>
+    struct tiered_codec {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "tiered_codec needs a specialization for this type");
+
+        static size_t size(const T &) {
+            return sizeof(T);
+        }
+
+        static void write(const T &value, char *out) {
+            std::memcpy(out, &value, sizeof(T));
+        }
+
+        static T read(const char *in, size_t) {
+            T value;
+            std::memcpy(&value, in, sizeof(T));
+            return value;
+        }
+    };
+
+    template<>
+    struct tiered_codec<std::string> {
+        static size_t size(const std::string &value) {
+            return value.size();
+        }
+
+        static void write(const std::string &value, char *out) {
+            std::memcpy(out, value.data(), value.size());
+        }
+
+        static std::string read(const char *in, size_t length) {
+            return std::string(in, length);
+        }
+    };
+
+    /**
+     * tiered_linked_hashmap keeps every key in memory but only as many
+     * values as fit a memory budget. Insertion order says which values are
+     * coldest: once the resident values outgrow the budget, the oldest are
+     * encoded into an append-only segment file and their entries become
+     * stubs (an offset and a length). A lookup of a stub reads the value
+     * back transparently; it then counts as the newest resident value, so
+     * a value that keeps being read stays in memory.
+     *
+     * Faulting a value back, overwriting or erasing it leaves its record
+     * dead in the segment. Once dead bytes outnumber live ones the segment
+     * is compacted by copying the live records into a fresh file.
+     *
+     * References returned by at() and operator[] stay valid until the next
+     * call that may spill, i.e. any other insert or lookup.
+     */
+
+template<
+	class Key,
+	class T,
+	class Hash = std::hash<Key>,
+	class Equal = std::equal_to<Key>,
+	class Codec = tiered_codec<T>
+> class tiered_linked_hashmap {
+private:
+    struct Entry;
+
+    // a value in memory, on the list of resident values in spill order
+    struct Resident {
+        T value;
+        Entry* entry;
+        Resident* prev;
+        Resident* next;
+        size_t bytes;
+
+        Resident(const T& v) : value(v), entry(nullptr), prev(nullptr), next(nullptr), bytes(0) {}
+    };
+
+    // either resident, or a stub pointing at its segment record
+    struct Entry {
+        Resident* resident;
+        unsigned long long offset;
+        size_t length;
+
+        Entry() : resident(nullptr), offset(0), length(0) {}
+    };
+
+    typedef linked_hashmap<Key, Entry, Hash, Equal> Index;
+
+    // below this many dead bytes a compaction is not worth a file copy
+    static const size_t COMPACT_MIN_BYTES = 1 << 20;
+
+    Index index;
+    Resident* coldest;
+    Resident* newest;
+    size_t resident_total;
+    size_t budget;
+    size_t spilled;
+
+    std::string path;
+    int fd;
+    unsigned long long segment_end;
+    unsigned long long live_total;
+    unsigned long long dead_total;
+
+    static void write_all(int file, const char* data, size_t length, unsigned long long offset) {
+        while (length > 0) {
+            ssize_t written = pwrite(file, data, length, offset);
+            if (written <= 0) throw runtime_error();
+            data += written;
+            length -= written;
+            offset += written;
+        }
+    }
+
+    static void read_all(int file, char* data, size_t length, unsigned long long offset) {
+        while (length > 0) {
+            ssize_t got = pread(file, data, length, offset);
+            if (got <= 0) throw runtime_error();
+            data += got;
+            length -= got;
+            offset += got;
+        }
+    }
+
+    void push_newest(Resident* r) {
+        r->prev = newest;
+        r->next = nullptr;
+        if (newest) {
+            newest->next = r;
+        } else {
+            coldest = r;
+        }
+        newest = r;
+    }
+
+    void unlink_resident(Resident* r) {
+        if (r->prev) {
+            r->prev->next = r->next;
+        } else {
+            coldest = r->next;
+        }
+        if (r->next) {
+            r->next->prev = r->prev;
+        } else {
+            newest = r->prev;
+        }
+        resident_total -= r->bytes;
+    }
+
+    void make_resident(Entry& entry, Resident* r) {
+        r->entry = &entry;
+        r->bytes = sizeof(Resident) + Codec::size(r->value);
+        entry.resident = r;
+        resident_total += r->bytes;
+        push_newest(r);
+    }
+
+    void spill(Resident* r) {
+        Entry& entry = *r->entry;
+        size_t length = Codec::size(r->value);
+        char* buffer = new char[length ? length : 1];
+        Codec::write(r->value, buffer);
+        try {
+            write_all(fd, buffer, length, segment_end);
+        } catch (...) {
+            delete[] buffer;
+            throw;
+        }
+        delete[] buffer;
+
+        entry.offset = segment_end;
+        entry.length = length;
+        segment_end += length;
+        live_total += length;
+        spilled++;
+        unlink_resident(r);
+        entry.resident = nullptr;
+        delete r;
+    }
+
+    /**
+     * spill the coldest values until the resident ones fit the budget.
+     * keep, the value the caller is about to hand out, is never spilled.
+     */
+    void enforce_budget(const Resident* keep) {
+        while (resident_total > budget && coldest && coldest != keep) {
+            spill(coldest);
+        }
+    }
+
+    void drop_record(size_t length) {
+        live_total -= length;
+        dead_total += length;
+        spilled--;
+        if (dead_total > live_total && dead_total >= COMPACT_MIN_BYTES) {
+            compact();
+        }
+    }
+
+    Resident* fault_in(Entry& entry) {
+        if (entry.resident) return entry.resident;
+        size_t length = entry.length;
+        char* buffer = new char[length ? length : 1];
+        Resident* r = nullptr;
+        try {
+            read_all(fd, buffer, length, entry.offset);
+            r = new Resident(Codec::read(buffer, length));
+        } catch (...) {
+            delete[] buffer;
+            throw;
+        }
+        delete[] buffer;
+        make_resident(entry, r);
+        drop_record(length);
+        return r;
+    }
+
+    void release_values() {
+        while (coldest) {
+            Resident* r = coldest;
+            unlink_resident(r);
+            delete r;
+        }
+    }
+
+public:
+	/**
+	 * the segment file is created (or truncated) at segment_path and
+	 * removed again by the destructor.
+	 * throw runtime_error if it cannot be created.
+	 */
+	tiered_linked_hashmap(const char *segment_path, size_t memory_budget)
+	        : coldest(nullptr), newest(nullptr), resident_total(0), budget(memory_budget), spilled(0),
+	          path(segment_path), fd(-1), segment_end(0), live_total(0), dead_total(0) {
+	    fd = ::open(segment_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	    if (fd < 0) throw runtime_error();
+	}
+
+	tiered_linked_hashmap(const tiered_linked_hashmap &) = delete;
+	tiered_linked_hashmap & operator=(const tiered_linked_hashmap &) = delete;
+
+	~tiered_linked_hashmap() {
+	    release_values();
+	    ::close(fd);
+	    ::unlink(path.c_str());
+	}
+
+	/**
+	 * access specified element with bounds checking, reading it back from
+	 * the segment if it was spilled.
+	 * throw index_out_of_bound if such key does not exist.
+	 */
+	T & at(const Key &key) {
+	    typename Index::iterator it = index.find(key);
+	    if (it == index.end()) throw index_out_of_bound();
+	    Resident* r = fault_in(it->second);
+	    enforce_budget(r);
+	    return r->value;
+	}
+
+	/**
+	 * access specified element, inserting a default value at the end if
+	 * such key does not exist.
+	 */
+	T & operator[](const Key &key) {
+	    if (!index.count(key)) {
+	        insert(pair<const Key, T>(key, T()));
+	    }
+	    return at(key);
+	}
+
+	/**
+	 * insert an element.
+	 * return true if inserted, false if the key was already there.
+	 */
+	bool insert(const pair<const Key, T> &value) {
+	    pair<typename Index::iterator, bool> placed = index.insert(typename Index::value_type(value.first, Entry()));
+	    if (!placed.second) return false;
+	    Resident* r = new Resident(value.second);
+	    make_resident(placed.first->second, r);
+	    enforce_budget(r);
+	    return true;
+	}
+
+	/**
+	 * erase the element with key.
+	 * return false if such key does not exist.
+	 */
+	bool erase(const Key &key) {
+	    typename Index::iterator it = index.find(key);
+	    if (it == index.end()) return false;
+	    Entry& entry = it->second;
+	    if (entry.resident) {
+	        unlink_resident(entry.resident);
+	        delete entry.resident;
+	        index.erase(it);
+	    } else {
+	        size_t length = entry.length;
+	        index.erase(it);
+	        drop_record(length);
+	    }
+	    return true;
+	}
+
+	size_t count(const Key &key) const {
+	    return index.count(key);
+	}
+
+	size_t size() const {
+	    return index.size();
+	}
+
+	bool empty() const {
+	    return index.empty();
+	}
+
+	void clear() {
+	    release_values();
+	    index.clear();
+	    if (ftruncate(fd, 0) != 0) throw runtime_error();
+	    segment_end = live_total = dead_total = 0;
+	    spilled = 0;
+	}
+
+	/**
+	 * change the memory budget, spilling at once if it shrank.
+	 */
+	void set_memory_budget(size_t bytes) {
+	    budget = bytes;
+	    enforce_budget(nullptr);
+	}
+
+	/**
+	 * bytes of values held in memory, estimated as the encoded size plus
+	 * per-value bookkeeping. Keys and stubs are not counted.
+	 */
+	size_t resident_bytes() const {
+	    return resident_total;
+	}
+
+	size_t spilled_count() const {
+	    return spilled;
+	}
+
+	/**
+	 * bytes in the segment file, live records and dead ones.
+	 */
+	size_t segment_bytes() const {
+	    return segment_end;
+	}
+
+	/**
+	 * copy the live records into a fresh segment, in insertion order, and
+	 * replace the old one. Runs on its own once dead records dominate.
+	 * throw runtime_error on I/O failure; the old segment is then kept.
+	 */
+	void compact() {
+	    std::string fresh_path = path + ".compact";
+	    int fresh = ::open(fresh_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+	    if (fresh < 0) throw runtime_error();
+
+	    unsigned long long end = 0;
+	    char* buffer = nullptr;
+	    size_t capacity = 0;
+	    try {
+	        for (typename Index::iterator it = index.begin(); it != index.end(); ++it) {
+	            const Entry& entry = it->second;
+	            if (entry.resident) continue;
+	            if (entry.length > capacity) {
+	                delete[] buffer;
+	                capacity = entry.length;
+	                buffer = new char[capacity];
+	            }
+	            read_all(fd, buffer, entry.length, entry.offset);
+	            write_all(fresh, buffer, entry.length, end);
+	            end += entry.length;
+	        }
+	        if (std::rename(fresh_path.c_str(), path.c_str()) != 0) throw runtime_error();
+	    } catch (...) {
+	        delete[] buffer;
+	        ::close(fresh);
+	        ::unlink(fresh_path.c_str());
+	        throw;
+	    }
+	    delete[] buffer;
+
+	    // the copy succeeded; only now move the stubs over
+	    unsigned long long offset = 0;
+	    for (typename Index::iterator it = index.begin(); it != index.end(); ++it) {
+	        Entry& entry = it->second;
+	        if (entry.resident) continue;
+	        entry.offset = offset;
+	        offset += entry.length;
+	    }
+	    ::close(fd);
+	    fd = fresh;
+	    segment_end = end;
+	    live_total = end;
+	    dead_total = 0;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,144 @@
+/**
+ * implement a sliding-window stream deduplicator on linked_hashmap
+ */
+#ifndef SJTU_WINDOW_DEDUP_HPP
+#define SJTU_WINDOW_DEDUP_HPP
+
+#include <cstddef>
+#include "linked_hashmap.hpp"
+
+namespace sjtu {
+    /**
+     * window_dedup tells first sightings from repeats in an event stream,
+     * where "repeat" means the key was seen within the last max_events
+     * events, or within the last max_age time units, or both.
+     *
+     * Each key remembers its latest sighting. The map's insertion order is
+     * kept as the order of latest sightings: a new key is appended at the
+     * tail, and a repeat is moved there with move_to_back(). So the keys
+     * that leave the window are always at the head, and each is popped in
+     * O(1). An offer costs one lookup plus O(1) amortized expiry.
+     *
+     * Times are whatever unit the caller passes (ns, ticks, seconds) and
+     * should not decrease; an earlier time is treated as the latest one.
+     */
+
+template<
+	class Key,
+	class Hash = std::hash<Key>,
+	class Equal = std::equal_to<Key>
+> class window_dedup {
+private:
+    struct Sighting {
+        unsigned long long event;
+        unsigned long long time;
+    };
+
+    typedef linked_hashmap<Key, Sighting, Hash, Equal> Map;
+
+    // how far ahead of the current key a batch prefetches
+    static const size_t PREFETCH_DISTANCE = 8;
+
+    Map seen;
+    size_t max_events;
+    unsigned long long max_age;
+    unsigned long long events;
+    unsigned long long latest;
+
+    // outside the window of the next event, whose number is `events`
+    bool expired(const Sighting& sighting) const {
+        return (max_events && events - sighting.event > max_events) ||
+               (max_age && latest - sighting.time >= max_age);
+    }
+
+    void expire_head() {
+        while (!seen.empty()) {
+            typename Map::iterator oldest = seen.begin();
+            if (!expired(oldest->second)) break;
+            seen.erase(oldest);
+        }
+    }
+
+public:
+	/**
+	 * a window of the last window_events events and/or the last
+	 * window_age time units; 0 leaves that side unbounded.
+	 * throw runtime_error if both are 0: such a window never forgets.
+	 */
+	window_dedup(size_t window_events, unsigned long long window_age = 0)
+	        : max_events(window_events), max_age(window_age), events(0), latest(0) {
+	    if (!max_events && !max_age) throw runtime_error();
+	}
+
+	/**
+	 * record one event at time now.
+	 * return true if key is fresh, false if it repeats within the window.
+	 */
+	bool offer(const Key &key, unsigned long long now = 0) {
+	    if (now > latest) latest = now;
+	    expire_head();
+	    Sighting sighting = {events++, latest};
+	    // one probe: insert finds a repeat and hands it back
+	    pair<typename Map::iterator, bool> placed = seen.insert(typename Map::value_type(key, sighting));
+	    bool first = placed.second;
+	    if (!first) {
+	        placed.first->second = sighting;
+	        seen.move_to_back(placed.first);
+	    }
+	    // the oldest event just left the count window
+	    expire_head();
+	    return first;
+	}
+
+	/**
+	 * offer keys[0..n) in order, all at time now, prefetching ahead.
+	 * fresh[i], if fresh is not null, is what offer(keys[i]) would return.
+	 * return the number of fresh keys.
+	 */
+	size_t offer(const Key *keys, size_t n, bool *fresh, unsigned long long now = 0) {
+	    size_t total = 0;
+	    for (size_t i = 0; i < n && i < PREFETCH_DISTANCE; ++i) seen.prefetch(keys[i]);
+	    for (size_t i = 0; i < n; ++i) {
+	        if (i + PREFETCH_DISTANCE < n) seen.prefetch(keys[i + PREFETCH_DISTANCE]);
+	        bool first = offer(keys[i], now);
+	        if (fresh) fresh[i] = first;
+	        total += first;
+	    }
+	    return total;
+	}
+
+	/**
+	 * let time pass without an event: forget keys older than max_age.
+	 */
+	void expire(unsigned long long now) {
+	    if (now > latest) latest = now;
+	    expire_head();
+	}
+
+	/**
+	 * whether key would be a repeat now, without recording an event.
+	 */
+	bool contains(const Key &key) const {
+	    typename Map::const_iterator it = seen.find(key);
+	    return it != seen.cend() && !expired(it->second);
+	}
+
+	/**
+	 * keys currently remembered; at most max_events if that is bounded.
+	 */
+	size_t size() const {
+	    return seen.size();
+	}
+
+	bool empty() const {
+	    return seen.empty();
+	}
+
+	void clear() {
+	    seen.clear();
+	}
+};
+
+}
+
+#endif